@@ -9,33 +9,87 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
 #include <math.h>
+
+// SIMD指令集检测：MinGW-w64 x86-64 默认启用SSE2，加 -mavx2 编译即启用AVX2路径
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#endif
+
+// 按字节对齐的全局数组（SIMD加载和缓存行对齐）
+#if defined(_MSC_VER)
+#define ALIGNED(n) __declspec(align(n))
+#else
+#define ALIGNED(n) __attribute__((aligned(n)))
+#endif
  
-// 窗口大小和模拟参数常量
-#define WINDOW_WIDTH 800
-#define WINDOW_HEIGHT 600
-#define MAX_RAINDROPS 1000              // 增加雨滴上限以支持暴雨场景
-#define MAX_RIPPLES 500                 // 涟漪上限
-#define MAX_SPLASHES 300                // 溅射水珠上限
+// 窗口大小和模拟参数常量；场景分辨率运行时由 --width/--height 决定
+#define DEFAULT_WINDOW_WIDTH 800
+#define DEFAULT_WINDOW_HEIGHT 600
+#define MAX_WINDOW_SIZE 16384           // 输出宽高上限
+// 粒子池和场景对象的默认容量，可用命令行参数修改（见 parse_options）
+#define DEFAULT_MAX_RAINDROPS 1000      // 增加雨滴上限以支持暴雨场景
+#define DEFAULT_MAX_RIPPLES 500         // 涟漪上限
+#define DEFAULT_MAX_SPLASHES 300        // 溅射水珠上限
+#define MAX_POOL_CAPACITY 16000000      // 单个池的容量上限
 #define MAX_LIGHTNING 5                 // 最大同时出现的闪电数
-#define POND_HEIGHT (WINDOW_HEIGHT * 2 / 3)  // 荷塘位于窗口高度的2/3处
 #define RIPPLE_LIFETIME 2000            // 涟漪生命周期（毫秒）
 #define SPLASH_LIFETIME 800             // 溅射水珠生命周期（毫秒）
 #define LIGHTNING_LIFETIME 500          // 闪电生命周期（毫秒）
+#define LIGHTNING_MAX_POINTS 20         // 闪电路径点上限
+#define LIGHTNING_GLOW_SIZE 64          // 闪电光晕纹理的横向分辨率
 #define RAINDROP_FALL_SPEED_MIN 200
 #define RAINDROP_FALL_SPEED_MAX 500     // 增加最大下落速度
 #define RIPPLE_SPEED 30                 // 涟漪扩散速度
-#define STARS_COUNT 300                 // 星星数量
+#define RIPPLE_SPRITE_MAX_RADIUS 60     // 涟漪精灵的最大半径（像素）
+#define RIPPLE_SPRITE_ELLIPSE_STEPS 8   // 椭圆压缩系数的量化级数
+#define RIPPLE_ATLAS_WIDTH 1024         // 涟漪图集宽度
+#define DEFAULT_STARS_COUNT 300         // 星星数量
 #define MOUNTAIN_COUNT 5                // 山的数量
 #define REED_COUNT 20                   // 芦苇数量
-#define LOTUS_PAD_COUNT 25              // 荷叶数量
+#define DEFAULT_LOTUS_PAD_COUNT 25      // 荷叶数量
 #define LOTUS_FLOWER_COUNT 8            // 荷花数量
+#define LOTUS_FLOWER_FRAMES 32          // 荷花旋转动画的预渲染帧数（覆盖相邻两片花瓣之间的角度）
+#define LOTUS_FLOWER_FRAME_COLUMNS 8    // 动画帧在纹理中每行排列的帧数
 #define MAX_CLOUD_LAYERS 7              // cloud layer number
+#define BACKGROUND_REFRESH_MS 100       // 星空层随星星闪烁重绘的间隔（毫秒）
+#define SIN_TABLE_SIZE 1024             // 正弦表分段数（2的幂）
+#define TEXTURE_CACHE_PATH "./texture_cache.bin"  // 程序化纹理的磁盘缓存
+#define TEXTURE_CACHE_MAGIC 0x4354524E  // "NRTC"
+#define TEXTURE_CACHE_VERSION 1         // 纹理生成算法或文件格式变化时加1，使旧缓存失效
+#define SIM_STEP_HZ 60                  // 固定步长模拟频率（步/秒）
+#define SIM_MAX_STEPS_PER_FRAME 5       // 单帧最多补偿的模拟步数，防止卡顿后越补越慢
+#define CACHE_LINE_SIZE 64              // 池内存按缓存行对齐
+#define SIMD_ROUND_UP(n) (((n) + 7) & ~7)  // 浮点数组按8个元素取整，便于SIMD整组处理
+#define THUNDER_CHUNK_FRAMES 4096       // 雷声按块流式解码，每块约0.1秒
+#define THUNDER_CACHE_CHUNKS 10         // 解码块缓存的容量，所有雷声共用
+#define THUNDER_PREFETCH_CHUNKS 2       // 主线程为每个雷声预先解码的后续块数
+#define MAX_THUNDER_VOICES 3            // 同时播放的雷声上限
+#define AUDIO_SAMPLE_RATE 44100
+#define AUDIO_BUFFER_FRAMES 2048        // 混音缓冲区帧数
+#define RAIN_SYNTH_PAN_BINS 8           // 落水点水平分布的分段数
+#define RAIN_SYNTH_MAX_GRAINS 32        // 同时发声的雨声颗粒上限
+#define RAIN_SYNTH_GRAIN_RATE 400.0f    // 每秒最多生成的颗粒数，更密的雨由底噪表现
+#define RAIN_SYNTH_REF_RATE 200.0f      // 底噪达到满音量时的落水速率（次/秒）
 
 // 天气状态枚举
 typedef enum {
@@ -46,20 +100,40 @@ typedef enum {
     WEATHER_COUNT          // 枚举计数
 } WeatherState;
 
-// 雨滴结构体
+// 雨滴池 - 结构数组(SoA)布局
+// 下落积分只读写 x/y/speed 等连续的浮点数组，一条SIMD指令可处理4-8个雨滴；
+// fall_mask 为 1.0f 表示雨滴处于下落状态（未入水），0.0f 表示静止
+// 存活的雨滴紧密排列在 [0, raindrop_count)，分配取末尾，回收时用末尾元素填补空位
+// 各数组在启动时按容量分配，首地址按缓存行对齐，浮点数组长度取整到8的倍数
 typedef struct {
-    float x;              // X坐标
-    float y;              // Y坐标
-    float z;              // Z坐标 (0-1, 0=远, 1=近)
-    float speed_y;        // 垂直下落速度
-    float speed_x;        // 水平速度（受风影响）
-    SDL_Color color;      // 雨滴颜色
-    int size;             // 雨滴基础大小
-    bool active;          // 雨滴是否激活
-    bool in_water;        // 雨滴是否已入水
-    Uint32 creation_time; // 雨滴创建时间
-    Uint32 water_time;    // 雨滴入水时间
-} Raindrop;
+    float* x;                 // X坐标
+    float* y;                 // Y坐标
+    float* z;                 // Z坐标 (0-1, 0=远, 1=近)
+    float* speed_x;           // 水平速度（受风影响）
+    float* speed_y;           // 垂直下落速度
+    float* prev_x;            // 上一帧X坐标（用于连续碰撞检测）
+    float* prev_y;            // 上一帧Y坐标
+    float* fall_mask;         // 下落掩码
+    SDL_Color* color;         // 雨滴颜色
+    Uint8* size;              // 雨滴基础大小
+    bool* in_water;           // 雨滴是否已入水
+    Uint32* creation_time;    // 雨滴创建时间
+    Uint32* water_time;       // 雨滴入水时间
+} RaindropPool;
+
+// 每个雨滴占用的内存：8个浮点数组 + 风力扰动和生成暂存区 + 颜色、大小、状态和两个时间戳
+#define RAINDROP_BYTES (10 * sizeof(float) + sizeof(SDL_Color) + sizeof(Uint8) + sizeof(bool) + 2 * sizeof(Uint32))
+
+// PCG32随机数流 - 每个子系统一个独立的流，相同种子产生相同的画面
+typedef struct {
+    Uint64 state;
+    Uint64 inc;       // 流编号（奇数）
+} Rng;
+
+// 批量随机数生成器 - 8个xorshift32通道，用SIMD一次生成8个数
+typedef struct {
+    ALIGNED(32) Uint32 lanes[8];
+} RngBulk;
 
 // 涟漪结构体
 typedef struct {
@@ -70,7 +144,6 @@ typedef struct {
     float max_radius;     // 最大半径
     SDL_Color color;      // 涟漪颜色
     Uint32 creation_time; // 涟漪创建时间
-    bool active;          // 涟漪是否激活
 } Ripple;
 
 // 溅射水珠结构体 - 用于荷叶上的雨滴溅射效果
@@ -80,16 +153,17 @@ typedef struct {
     float z;              // Z坐标 (0-1, 0=远, 1=近)
     float speed_x;        // X方向速度
     float speed_y;        // Y方向速度
+    float prev_x;         // 上一步X坐标（用于渲染插值）
+    float prev_y;         // 上一步Y坐标
     float size;           // 水珠大小
     SDL_Color color;      // 水珠颜色
     Uint32 creation_time; // 创建时间
-    bool active;          // 是否激活
 } Splash;
 
 // 闪电结构体
 typedef struct {
     int segments;         // 闪电段数
-    int points[20][2];    // 闪电路径点 [seg][x/y]
+    int points[LIGHTNING_MAX_POINTS][2]; // 闪电路径点 [seg][x/y]
     int width;            // 闪电宽度
     Uint8 brightness;     // 亮度
     Uint32 creation_time; // 创建时间
@@ -114,8 +188,20 @@ typedef struct {
     int height;           // 山高
     int width;            // 山宽
     SDL_Color color;      // 山的颜色
+    SDL_Texture *texture; // 白色山体剪影，绘制时用颜色调制着色
 } Mountain;
 
+// 静态背景层：缓存在渲染目标纹理中，输入不变时每帧只需一次拷贝
+typedef struct {
+    SDL_Texture* texture;     // 层内容，覆盖水面以上区域
+    SDL_Texture* glow;        // 同形状的白色蒙版，闪电时以加色混合叠加
+    bool valid;
+    float camera_x;           // 上次绘制时的输入，任何一项变化都要重绘
+    WeatherState weather;
+    int intensity;
+    Uint32 tick;
+} BackgroundLayer;
+
 // 芦苇结构体
 typedef struct {
     float x;              // X坐标
@@ -148,8 +234,347 @@ typedef struct {
     float sway_phase;     // 摇摆相位
     SDL_Color color;      // 颜色
     int petal_count;      // 花瓣数量
+    SDL_Texture *texture; // 预渲染的旋转动画帧
+    int frame_half_w;     // 每帧中心到左右、上下边缘的距离
+    int frame_half_h;
 } LotusFlower;
 
+// 碰撞网格参数：屏幕空间按 COLLISION_CELL_SIZE 划分单元，深度按 COLLISION_Z_RANGE 划分为z段
+// 雨滴只与深度差小于 COLLISION_Z_RANGE 的物体相撞，因此只需查询相邻的3个z段
+#define COLLISION_CELL_SIZE 32
+#define COLLISION_GRID_COLS ((window_width + COLLISION_CELL_SIZE - 1) / COLLISION_CELL_SIZE)
+#define COLLISION_GRID_ROWS ((window_height + COLLISION_CELL_SIZE - 1) / COLLISION_CELL_SIZE)
+#define COLLISION_Z_RANGE 0.2f
+#define COLLISION_Z_BANDS 5
+#define COLLISION_GRID_CELLS (COLLISION_GRID_COLS * COLLISION_GRID_ROWS * COLLISION_Z_BANDS)
+
+// 可被雨滴击中的物体类型
+typedef enum {
+    COLLIDER_LOTUS_PAD,
+    COLLIDER_LOTUS_FLOWER,
+    COLLIDER_REED
+} ColliderType;
+
+// 碰撞体 - 已按当前相机投影到屏幕空间
+typedef struct {
+    ColliderType type;    // 物体类型
+    int index;            // 在对应数组中的下标
+    float x;              // 屏幕X中心
+    float y;              // 屏幕Y中心
+    float z;              // Z坐标 (0-1, 0=远, 1=近)
+    float radius;         // 圆形半径（荷叶、荷花）
+    float half_w;         // 矩形半宽（芦苇）
+    float half_h;         // 矩形半高（芦苇）
+} Collider;
+
+// 均匀网格 - 按单元压缩存储碰撞体下标
+// 单元 c 中的碰撞体为 cell_items[cell_start[c] .. cell_start[c+1])
+typedef struct {
+    Collider* colliders;  // 容量为荷叶、荷花、芦苇数量之和
+    int collider_count;
+    int collider_capacity;
+    int* cell_start;      // COLLISION_GRID_CELLS + 1 个，网格大小随场景分辨率确定
+    int* cell_fill;       // 填充时各单元的写入位置
+    int* cell_items;      // 每个碰撞体平均最多占16个单元
+    int ref_capacity;
+    float min_y;          // 所有碰撞体的最高点，雨滴在此之上可直接跳过查询
+    float camera_x;       // 构建网格时的相机位置
+    bool dirty;           // 荷叶等物体移动后需要重建
+} CollisionGrid;
+
+// 一次碰撞查询的结果
+typedef struct {
+    ColliderType type;    // 击中的物体类型
+    int index;            // 击中的物体下标
+    float t;              // 在本帧位移上的参数位置 (0-1)
+} CollisionHit;
+
+// 帧时间上下文 - 每帧只读取一次时钟，传给所有更新和渲染函数
+typedef struct {
+    Uint64 counter;       // 本帧开始时的性能计数器读数
+    Uint64 sim_ticks;     // 已执行的模拟步数
+    Uint32 ms;            // 当前模拟时间（毫秒），与各对象的 creation_time 比较
+    float delta_time;     // 固定步长（秒）
+    float alpha;          // 渲染插值系数 (0-1)：在上一步与当前步状态之间的比例
+    Uint32 render_ms;     // 插值后的渲染时刻（毫秒）
+} FrameTime;
+
+// 工作线程池参数
+#define MAX_WORKER_THREADS 31           // 后台工作线程上限（加上主线程共32个）
+#define PARALLEL_MIN_ITEMS 4096         // 元素少于此数量时直接在当前线程执行
+#define PARALLEL_CHUNK_SIZE 2048        // 并行循环每个任务块的元素数
+#define RASTER_TILE_SIZE 64             // 平铺光栅化的分块边长（像素）
+#define WORK_QUEUE_SIZE 256             // 每个线程的工作窃取队列容量（2的幂）
+#define MAX_GRAPH_TASKS 32              // 任务图节点上限
+#define MAX_TASK_LINKS 8                // 每个任务的前驱/后继上限
+
+// 并行循环的任务函数：处理 [begin, end)，worker 为执行线程编号（0为主线程）
+typedef void (*ParallelForFunc)(int begin, int end, int worker, void* userdata);
+
+// 可执行的工作单元：并行循环的一个任务块，或任务图的一个节点
+typedef struct {
+    ParallelForFunc func;
+    void* userdata;
+    int begin;
+    int end;
+    SDL_atomic_t* pending;     // 完成后递减的计数器，等待方据此判断是否全部完成
+} Job;
+
+// 工作窃取队列 - 所有者从底部压入/弹出（后进先出，缓存友好），空闲线程从顶部窃取
+typedef struct ALIGNED(64) {
+    SDL_SpinLock lock;
+    int top;
+    int bottom;
+    Job jobs[WORK_QUEUE_SIZE];
+} WorkQueue;
+
+// 常驻工作线程池 - 每个线程（含主线程）一个队列，线程空闲时从其他队列窃取
+typedef struct {
+    SDL_Thread* threads[MAX_WORKER_THREADS];
+    int thread_count;          // 后台工作线程数（不含主线程）
+    WorkQueue queues[MAX_WORKER_THREADS + 1];
+    SDL_TLSID worker_tls;      // 当前线程的编号+1（非池内线程为0）
+    SDL_atomic_t queued_jobs;  // 所有队列中待执行的工作单元数
+    SDL_atomic_t sleeping;     // 正在休眠的线程数（空闲的工作线程和等待任务完成的线程）
+    SDL_mutex* lock;
+    SDL_cond* work_ready;      // 有新工作或退出时广播
+    bool quit;
+} WorkerPool;
+
+// 任务图节点函数
+typedef void (*TaskFunc)(const FrameTime* ft);
+
+struct TaskGraph;
+
+// 任务图节点：所有前驱完成后才会被放入队列
+typedef struct {
+    const char* name;
+    TaskFunc func;
+    struct TaskGraph* graph;
+    int successors[MAX_TASK_LINKS];
+    int successor_count;
+    int dependencies[MAX_TASK_LINKS];
+    int dependency_count;
+    SDL_atomic_t unfinished;   // 尚未完成的前驱数
+    Uint64 start;              // 开始/结束时刻（性能计数器）
+    Uint64 end;
+    Uint64 nested;             // 等待并行循环时在本线程嵌套执行的其他任务的耗时，不计入本任务
+    int worker;                // 执行该任务的线程编号
+} GraphTask;
+
+// 依赖感知的任务图 - 无数据往来的阶段并行执行，只在数据流动处汇合
+typedef struct TaskGraph {
+    GraphTask tasks[MAX_GRAPH_TASKS];
+    int task_count;
+    const FrameTime* ft;
+    SDL_atomic_t remaining;    // 尚未完成的任务数
+    GraphTask* running[MAX_WORKER_THREADS + 1]; // 各线程正在执行的任务（嵌套时为最内层）
+} TaskGraph;
+
+// 粒子更新在并行阶段产生的新粒子（涟漪、水珠），并行结束后统一创建
+typedef enum {
+    SPAWN_RIPPLE,
+    SPAWN_SPLASH
+} SpawnType;
+
+typedef struct {
+    int source;           // 产生事件的粒子下标，合并时按它排序，保证结果与线程数无关
+    SpawnType type;       // 要创建的粒子类型
+    float x;
+    float y;
+    float z;
+    SDL_Color color;
+} SpawnEvent;
+
+// 每个线程独占的生成缓冲区（按缓存行对齐，避免伪共享）
+typedef struct ALIGNED(64) {
+    SpawnEvent* events;   // 待创建的粒子
+    int event_count;
+    int event_capacity;
+    int* removals;        // 待回收的粒子下标
+    int removal_count;
+    int removal_capacity;
+    int dropped_events;   // 扩容失败而丢弃的数量，合并时报告
+    int dropped_removals;
+} WorkerBuffer;
+
+// 落水事件统计 - 模拟中只累加计数和分布，每帧在主线程汇总后交给雨声合成器
+typedef struct {
+    int impacts;                            // 本帧累计的落水次数
+    float loudness;                         // 累计响度（近处的落水更响）
+    float pan[RAIN_SYNTH_PAN_BINS];         // 各水平分段的累计响度
+    bool thunder_pending;                   // 本帧有新的闪电，雷声只播放一次
+    int impacts_total;                      // 累计落水次数
+} AudioVoices;
+
+// 雨声合成参数 - 主线程写入，音频线程读取
+typedef struct {
+    float rate;                             // 每秒落水次数
+    float loudness;                         // 平均响度 (0-1)
+    float pan[RAIN_SYNTH_PAN_BINS];         // 落水点水平分布（和为1）
+} RainSynthParams;
+
+// 雨声颗粒：一段指数衰减的滤波噪声，模拟单个雨点的声音
+typedef struct {
+    float amp;            // 当前包络幅度
+    float decay;          // 每帧的衰减系数
+    float gain_l;         // 左右声道增益（等功率声像）
+    float gain_r;
+    float lp;             // 低通滤波状态
+    float lp_coef;        // 低通系数，越大越明亮
+    int start;            // 在当前缓冲区中的起始帧
+    int noise_offset;     // 噪声表的读取偏移，使各颗粒互不相关
+} RainGrain;
+
+// 程序化雨声合成器 - 注册为SDL_mixer的后期混音回调，开销与雨滴数量无关
+typedef struct {
+    bool enabled;
+    int sample_rate;
+    SDL_SpinLock lock;                      // 保护 target
+    RainSynthParams target;                 // 主线程最新上报的参数
+    RainSynthParams current;                // 音频线程平滑后的参数
+    RngBulk noise_rng;                      // 噪声（批量生成）
+    Rng grain_rng;                          // 颗粒的时刻、声像和音色
+    float grain_debt;                       // 尚未生成的颗粒数
+    float bed_lp[2];                        // 底噪带通滤波状态（左右声道）
+    float bed_hp[2];
+    RainGrain grains[RAIN_SYNTH_MAX_GRAINS];
+    int grain_count;
+    ALIGNED(32) float noise[SIMD_ROUND_UP(AUDIO_BUFFER_FRAMES * 3)];  // 两路底噪和一路颗粒噪声
+    ALIGNED(32) float mix[AUDIO_BUFFER_FRAMES * 2];                   // 交错的左右声道
+} RainSynth;
+
+// 流式解码的WAV音频：文件保持打开，播放时按块读取和解码（支持16位PCM和IMA ADPCM）
+typedef struct {
+    SDL_RWops* file;
+    int format;                 // 1 = PCM，0x11 = IMA ADPCM
+    int channels;               // 1或2
+    int sample_rate;
+    Sint64 data_offset;         // 样本数据在文件中的位置
+    int block_align;            // PCM为每帧字节数，ADPCM为每块字节数
+    int block_frames;           // ADPCM每块的帧数
+    int total_frames;
+    int chunk_frames;           // 每个解码块的帧数（ADPCM取整数个块）
+    int chunk_bytes;            // 每个解码块在文件中的字节数
+    Uint8* raw;                 // 读文件的暂存区
+} SoundStream;
+
+// 解码块缓存的一项：一块立体声16位样本
+typedef struct {
+    int chunk;                  // 块编号，-1为空
+    int frames;
+    Uint32 last_use;
+    Sint16* samples;
+} SoundCacheEntry;
+
+typedef struct {
+    bool active;
+    Uint64 position;            // 源音频中的位置（帧，16.16定点）
+} ThunderVoice;
+
+// 雷声播放器 - 主线程从磁盘流式解码到共用的解码块缓存，后期混音回调只从缓存读取；
+// 第一次进入大雨或雷暴时才分配缓存，之前只占用一个打开的文件
+typedef struct {
+    SoundStream stream;
+    bool loaded;
+    SDL_SpinLock lock;                      // 保护 loaded、pending_starts、声部和缓存项
+    int pending_starts;                     // 主线程请求播放、尚未开始的雷声数
+    Uint64 step;                            // 每个输出帧前进的源帧数（16.16定点）
+    ThunderVoice voices[MAX_THUNDER_VOICES];
+    SoundCacheEntry cache[THUNDER_CACHE_CHUNKS];
+    Uint32 use_clock;
+    int decoded_chunks;                     // 统计：解码次数和缓存命中次数
+    int cache_hits;
+} ThunderPlayer;
+
+// 平铺光栅化命令：数量最多的图元（涟漪、水珠、雨滴）先记录下来，按屏幕分块并行绘制
+typedef enum {
+    RASTER_SKIP,          // 被剔除的图元（并行记录时占位）
+    RASTER_SPRITE,        // 从涟漪图集拷贝，按纹理透明度与颜色混合
+    RASTER_DISC,          // 不透明实心圆
+    RASTER_LINE           // 不透明线段
+} RasterCmdType;
+
+typedef struct {
+    RasterCmdType type;
+    Uint32 color;         // ARGB8888；精灵的最高字节为透明度调制
+    SDL_Rect bounds;      // 屏幕上的包围盒（已按屏幕和裁剪矩形裁剪）
+    int x0, y0;           // 精灵/线段起点，或圆心
+    int x1, y1;           // 精灵在图集中的位置，或线段终点；圆的 x1 为半径
+} RasterCmd;
+
+// 平铺光栅化后端 - 软件渲染时启用：SDL把场景画到内存帧，粒子由工作线程按分块直接写像素，
+// 整帧通过一张流式纹理交给输出渲染器
+typedef struct {
+    bool active;
+    SDL_Surface* surface;          // 场景帧（render_width x render_height，ARGB8888）
+    SDL_Renderer* scene_renderer;  // 绘制到 surface 的软件渲染器
+    SDL_Texture* frame_texture;    // 输出渲染器上的流式纹理
+    SDL_Surface* ripple_atlas;     // 涟漪图集的内存副本
+    RasterCmd* cmds;
+    int cmd_count;
+    int cmd_capacity;
+    float scale;                   // 场景坐标到帧像素的缩放（内部渲染比例）
+    int tiles_x;
+    int tiles_y;
+    int* tile_start;               // 每个分块的命令列表在 tile_items 中的起点（前缀和）
+    int* tile_items;               // 按分块排列的命令下标，分块内保持记录顺序
+    int item_capacity;
+} SoftRaster;
+
+// 启动时生成的程序化表面：工作线程并行填充像素，主线程再按登记顺序上传为纹理
+typedef enum {
+    STARTUP_MOON,
+    STARTUP_CLOUD,
+    STARTUP_RIPPLE_ATLAS,
+    STARTUP_LIGHTNING_GLOW,
+    STARTUP_MOUNTAIN,
+    STARTUP_LOTUS_PAD,
+    STARTUP_LOTUS_FLOWER
+} StartupSurfaceType;
+
+typedef struct {
+    StartupSurfaceType type;
+    int index;                // 云层、山、荷叶或荷花的下标
+    SDL_Surface* surface;     // 生成结果，上传后释放
+    double time;              // 生成耗时（毫秒）
+} StartupSurface;
+
+// 纹理缓存文件：文件头、每张表面一个条目、按64字节对齐的像素数据（ARGB8888，每行 w*4 字节）
+typedef struct {
+    Uint32 magic;
+    Uint32 version;
+    Uint64 key;               // 生成参数和随机种子的散列，不一致时缓存失效
+    Uint64 file_size;
+    Uint32 entry_count;
+    Uint32 reserved;
+} TextureCacheHeader;
+
+typedef struct {
+    Uint32 type;              // StartupSurfaceType
+    Uint32 index;
+    Sint32 w;
+    Sint32 h;
+    Uint64 offset;            // 像素数据在文件中的位置
+} TextureCacheEntry;
+
+// 启动各阶段耗时（毫秒），进入主循环前打印
+typedef struct {
+    Uint64 start;             // 程序开始时刻
+    double sdl_init;          // SDL、窗口、渲染器、粒子池和线程池
+    double scene_setup;       // 场景参数：按固定顺序消耗 scene_rng
+    double surface_gen;       // 并行生成表面（实际经过的时间）
+    double surface_cpu;       // 各表面生成耗时之和
+    int surface_count;
+    double texture_upload;    // 主线程上传纹理
+    double background;        // 背景层渲染目标
+    bool cache_hit;           // 纹理从磁盘缓存载入，跳过了生成
+    double cache_io;          // 映射并校验缓存，或写入缓存
+    double audio_decode;      // 后台线程加载和解码音频
+    double audio_wait;        // 主线程等待音频加载完成
+    double total;
+} StartupTiming;
+
 /* struct to moniter performance */
 typedef struct {
     Uint64 freq;           // 计时器频率
@@ -160,36 +585,153 @@ typedef struct {
     double avg_frame_time; // 平均帧时间（滑动平均）
     double physics_time;   // 物理计算耗时
     double render_time;    // 渲染耗时
+    double work_time;      // 输入、物理和渲染的工作耗时（不含呈现时的垂直同步等待）
+    int sim_steps;         // 本帧执行的模拟步数
+    int task_count;        // 模拟任务图的任务数
+    const char* task_names[MAX_GRAPH_TASKS];
+    double task_time[MAX_GRAPH_TASKS]; // 本帧各任务累计耗时
+    double critical_path_time;         // 本帧各步关键路径耗时之和
     int frame_count;       // 帧计数器
+    Uint64 run_start;      // 主循环开始时刻
+    double physics_total;  // 累计物理耗时（毫秒）
+    double render_total;   // 累计渲染耗时（毫秒）
 } PerformanceStats;
 
+// 画质调节器：工作耗时超出帧预算时逐级降低画质，长时间有余量时逐级恢复
+#define QUALITY_LEVELS 5
+#define QUALITY_DOWN_FRAMES 6           // 平均耗时连续超预算这么多帧后降一级
+#define QUALITY_UP_FRAMES 120           // 平均耗时连续低于余量线这么多帧后升一级
+#define QUALITY_UP_FRAMES_MAX 960       // 升级后很快又降级时，升级等待时间加倍，直到此上限
+#define QUALITY_COOLDOWN_FRAMES 10      // 调整后等待滑动平均反映新画质的帧数
+#define QUALITY_HEADROOM 0.7f           // 平均耗时低于预算的此比例才算有余量
+#define QUALITY_SPIKE 1.5f              // 单帧耗时超过预算的此倍数时立即降级（雷暴闪电等突发峰值）
+
+// 每级画质下各项开销的倍数（1为全画质）
+typedef struct {
+    float spawn;           // 雨滴生成速率
+    float ripples;         // 保留的涟漪比例
+    float splash_beads;    // 每次溅射的水珠数量
+    float clouds;          // 云层数量
+    float render_scale;    // 内部渲染比例（乘在 --render-scale 上）
+} QualitySettings;
+
+typedef struct {
+    bool enabled;
+    double budget_ms;      // 帧预算：每帧工作耗时的目标
+    int level;             // 当前画质级别，0为全画质
+    double avg_work;       // 工作耗时的滑动平均
+    int over_frames;       // 连续超预算的帧数
+    int under_frames;      // 连续有余量的帧数
+    int up_frames;         // 升一级需要的连续有余量帧数（随反复升降而加倍）
+    int cooldown;          // 剩余的冷却帧数
+    int frames_since_change;
+    int changes;           // 调整次数
+    bool raised;           // 上一次调整是否为升级
+    float ripple_debt;     // 按比例保留涟漪时的累计量
+    int level_frames[QUALITY_LEVELS]; // 各级停留的帧数
+} QualityGovernor;
+
+// 命令行选项
+typedef struct {
+    bool headless;         // 无界面模式：不创建窗口，渲染到内存表面
+    bool audio;            // 是否打开音频设备
+    bool help;
+    int frames;            // 运行的帧数，0表示一直运行
+    int width;             // 输出分辨率，也是场景的逻辑分辨率
+    int height;
+    float render_scale;    // 内部渲染分辨率与输出分辨率之比
+    float frame_budget;    // 画质调节器的帧预算（毫秒），0为关闭，-1为自动
+    int weather;           // 初始天气，-1表示默认
+    Uint64 seed;           // 随机种子
+    const char* screenshot; // 最后一帧保存的BMP路径
+    int max_raindrops;     // 粒子池和场景对象的容量
+    int max_ripples;
+    int max_splashes;
+    int stars;
+    int lotus_pads;
+    bool sdl_raster;       // 软件渲染时也不使用平铺光栅化后端
+    bool texture_cache;    // 启动时读写程序化纹理的磁盘缓存
+    const char* bad_arg;   // 解析失败的参数
+} AppOptions;
+
 // 全局变量 global para
 SDL_Window* window = NULL;
-SDL_Renderer* renderer = NULL;
-Mix_Chunk *splash_sound = NULL;
-Mix_Chunk *lightning_sound = NULL;
+SDL_Renderer* renderer = NULL;          // 场景绘制使用的渲染器
+SDL_Renderer* output_renderer = NULL;   // 呈现到窗口或离屏表面的渲染器；未启用平铺光栅化时与 renderer 相同
+SoftRaster soft_raster;
+SDL_Surface* headless_surface = NULL;   // 无界面模式的渲染目标
+AppOptions options;
+ThunderPlayer thunder;
 Mix_Music *bgm_music = NULL;
-Raindrop raindrops[MAX_RAINDROPS];
-Ripple ripples[MAX_RIPPLES];
-Splash splashes[MAX_SPLASHES];
+SDL_Thread* audio_loader = NULL;        // 启动时在后台加载音频的线程
+AudioVoices audio_voices;
+RainSynth rain_synth;
+RaindropPool raindrops;
+float* rain_jitter;                     // 暴雨时单个雨滴的随机风力扰动，取值 -1 到 1，每步批量生成
+float* rain_spawn_random;               // 批量生成雨滴时的随机数暂存区
+// 随机数流：每个流只在一条依赖链上使用，多线程下消耗顺序也固定
+Rng scene_rng;                          // 场景初始化（星星、山、荷叶、荷花、芦苇）
+Rng weather_rng;                        // 天气与风
+Rng spawn_rng;                          // 雨滴和闪电的生成
+Rng particle_rng;                       // 涟漪和水珠
+Rng lightning_rng;                      // 闪电形状
+Rng render_rng;                         // 渲染时的随机效果
+RngBulk rain_jitter_rng;                // 雨滴风力扰动
+RngBulk rain_spawn_rng;                 // 批量生成雨滴的深度、落点和速度
+Ripple* ripples;                        // 存活涟漪紧密排列在 [0, ripple_count)
+Splash* splashes;                       // 存活水珠紧密排列在 [0, splash_count)
 Lightning lightnings[MAX_LIGHTNING];
 SDL_Texture *moon_texture = NULL; //use texture to improve performance
-Star stars[STARS_COUNT];
+Star* stars;
 Mountain mountains[MOUNTAIN_COUNT];
+BackgroundLayer sky_layer;              // 夜空底色、星星和月亮
+BackgroundLayer mountain_layer;         // 远山剪影
 SDL_Texture *cloud_textures[MAX_CLOUD_LAYERS];  // use texture to improve performance
 int cloud_offsets[MAX_CLOUD_LAYERS];    
+// 涟漪图集：按半径和椭圆压缩系数预渲染的白色圆环，绘制时用颜色/透明度调制
+SDL_Texture *ripple_atlas = NULL;
+SDL_Texture *lightning_glow = NULL;     // 预先模糊的闪电光晕：横向高斯衰减的白色条带
+SDL_Texture *scene_target = NULL;       // 降分辨率渲染的离屏目标（不使用平铺光栅化时）
+SDL_Rect ripple_sprites[RIPPLE_SPRITE_ELLIPSE_STEPS][RIPPLE_SPRITE_MAX_RADIUS + 1];
+int ripple_atlas_height = 0;            // 图集高度，由 layout_ripple_sprites 确定
 Reed reeds[REED_COUNT];
-LotusPad lotus_pads[LOTUS_PAD_COUNT];
+LotusPad* lotus_pads;
 LotusFlower lotus_flowers[LOTUS_FLOWER_COUNT];
+CollisionGrid collision_grid = { .dirty = true };
+WorkerPool worker_pool;
+WorkerBuffer worker_buffers[MAX_WORKER_THREADS + 1];  // 下标0为主线程
+TaskGraph sim_graph;                    // 每个模拟步执行的任务图
 PerformanceStats perf;
+QualityGovernor quality;
 
-int raindrop_count = 0;
-int ripple_count = 0;
-int splash_count = 0;
+// 先减少云层、涟漪和水珠，再降低雨量和渲染分辨率
+static const QualitySettings quality_levels[QUALITY_LEVELS] = {
+    {1.00f, 1.00f, 1.00f, 1.00f, 1.00f},
+    {1.00f, 0.75f, 0.75f, 0.60f, 1.00f},
+    {0.85f, 0.60f, 0.50f, 0.45f, 0.85f},
+    {0.70f, 0.50f, 0.40f, 0.30f, 0.70f},
+    {0.50f, 0.35f, 0.25f, 0.30f, 0.50f},
+};
+StartupTiming startup_timing;
+
+int max_raindrops = DEFAULT_MAX_RAINDROPS;   // 各池容量，启动时由命令行参数确定
+int max_ripples = DEFAULT_MAX_RIPPLES;
+int max_splashes = DEFAULT_MAX_SPLASHES;
+int stars_count = DEFAULT_STARS_COUNT;
+int lotus_pad_count = DEFAULT_LOTUS_PAD_COUNT;
+int window_width = DEFAULT_WINDOW_WIDTH;     // 场景分辨率：所有几何以此为坐标系，启动时取输出分辨率
+int window_height = DEFAULT_WINDOW_HEIGHT;
+int pond_height = DEFAULT_WINDOW_HEIGHT * 2 / 3;  // 荷塘位于窗口高度的2/3处
+float render_scale = 1.0f;              // 内部渲染分辨率与场景分辨率之比
+int render_width = DEFAULT_WINDOW_WIDTH;     // 内部渲染分辨率：场景先画到这个尺寸再线性放大到输出
+int render_height = DEFAULT_WINDOW_HEIGHT;
+int raindrop_count = 0;                 // 存活雨滴数，同时是下一个空闲槽位
+int ripple_count = 0;                   // 存活涟漪数，同时是下一个空闲槽位
+int splash_count = 0;                   // 存活水珠数，同时是下一个空闲槽位
 int lightning_count = 0;
-Uint32 last_raindrop_time = 0;
 Uint32 last_lightning_time = 0;
-int raindrop_interval = 100;            // 雨滴生成间隔（毫秒），会根据天气变化
+float raindrop_interval = 100.0f;       // 雨滴生成间隔（毫秒），会根据天气变化
+float rain_spawn_debt = 0.0f;           // 按生成速率累计、尚未生成的雨滴数（含小数部分）
 float camera_x = 0.0f;                  // 摄像机X位置，用于视角移动
 float camera_target_x = 0.0f;           // 摄像机目标X位置
 bool camera_moving = false;             // 摄像机是否在移动
@@ -213,41 +755,123 @@ int thunder_duration = 0;               // 雷声持续时间
 
 // 函数原型 function prototype
 bool initialize();
-void close();
-void draw_crater(SDL_Surface* surface, int cx, int cy, int radius, Uint32 color);
-void create_raindrop(bool on_surface);
-void update_raindrops(Uint32 current_time, float delta_time);
-void create_ripple(float x, float y, float z, SDL_Color color);
-void update_ripples(Uint32 current_time);
-void create_splash(float x, float y, float z, SDL_Color color);
-void update_splashes(Uint32 current_time, float delta_time);
-void create_lightning(int x, int y, int length, int width, int type);
-void update_lightning(Uint32 current_time);
-void initialize_moon();
-void initialize_cloud();
+void close_app();
+void platform_init_console(bool headless);
+const void* platform_map_file(const char* path, size_t* size);
+void platform_unmap_file(const void* data, size_t size);
+bool platform_replace_file(const char* from, const char* to);
+void print_usage();
+bool parse_options(int argc, char* args[], AppOptions* opt);
+bool save_screenshot(const char* path);
+void* cache_aligned_alloc(size_t size);
+void cache_aligned_free(void* ptr);
+bool allocate_pools();
+void free_pools();
+bool init_worker_pool(int thread_count);
+void shutdown_worker_pool();
+void parallel_for(int count, int chunk_size, ParallelForFunc func, void* userdata);
+void parallel_for_coarse(int count, int chunk_size, ParallelForFunc func, void* userdata);
+void init_task_graph(TaskGraph* graph);
+int add_task(TaskGraph* graph, const char* name, TaskFunc func);
+void add_task_dependency(TaskGraph* graph, int task, int dependency);
+void run_task_graph(TaskGraph* graph, const FrameTime* ft);
+double task_time_ms(const GraphTask* task);
+double task_graph_critical_path(const TaskGraph* graph);
+void fill_disc(SDL_Surface* surface, int cx, int cy, int radius, Uint32 color);
+int create_raindrops(int n, Uint32 current_time);
+void update_raindrops(const FrameTime* ft);
+void remove_raindrop(int index);
+void create_ripple(float x, float y, float z, SDL_Color color, Uint32 current_time);
+void queue_splash_sound(float x, float z);
+void queue_thunder_sound();
+void flush_audio_voices(float sim_seconds);
+void init_rain_synth();
+bool open_sound_stream(SoundStream* stream, const char* path);
+void close_sound_stream(SoundStream* stream);
+bool load_thunder_sound();
+void prefetch_thunder_chunks(ThunderPlayer* player);
+void free_thunder_sound();
+void rain_synth_postmix(void* udata, Uint8* stream, int len);
+void remove_ripple(int index);
+void update_ripples(const FrameTime* ft);
+void create_splash(float x, float y, float z, SDL_Color color, Uint32 current_time);
+void remove_splash(int index);
+void update_splashes(const FrameTime* ft);
+void create_lightning(int x, int y, int length, int width, int type, Uint32 current_time);
+void update_lightning(const FrameTime* ft);
+bool initialize_scene();
+void start_audio_loading();
+void finish_audio_loading();
+void print_startup_timing();
+SDL_Surface* generate_moon_surface();
+SDL_Surface* generate_cloud_surface(int layer);
+void layout_ripple_sprites();
+SDL_Surface* generate_ripple_atlas_surface();
+SDL_Surface* generate_lightning_glow_surface();
+void initialize_background_layers();
+void destroy_background_layer(BackgroundLayer* layer);
+bool init_scene_target();
+void set_scene_render_target(SDL_Texture* target);
+void present_scene_target();
+void apply_render_scale(float scale);
+void init_quality_governor();
+void update_quality_governor(double work_ms);
+void print_quality_summary();
+const QualitySettings* current_quality();
+bool init_soft_raster();
+void shutdown_soft_raster();
+void raster_begin();
+void raster_end();
+void present_soft_raster();
+void render_lightning_bolt(const Lightning* bolt);
 void initialize_stars();
 void initialize_mountains();
+SDL_Surface* generate_mountain_surface(const Mountain *mountain);
 void initialize_reeds();
-void generate_lotus_texture(LotusPad *pad);
+SDL_Surface* generate_lotus_surface(const LotusPad *pad);
 void initialize_lotus_pads();
 void render_lotus_texture(LotusPad *pad, int proj_x, float tilt);
 void destroy_lotus_textures();
 void initialize_lotus_flowers();
-void update_stars(Uint32 current_time);
-void update_lotus_pads(Uint32 current_time, float delta_time);
-void update_lotus_flowers(Uint32 current_time, float delta_time);
+SDL_Surface* generate_flower_surface(const LotusFlower *flower);
+void destroy_flower_textures();
+void update_stars(const FrameTime* ft);
+void update_lotus_pads(const FrameTime* ft);
+void update_lotus_flowers(const FrameTime* ft);
 void update_camera();
-void update_weather_and_wind(Uint32 current_time);
-void update_thunder(Uint32 current_time);
-bool check_raindrop_lotus_collision(Raindrop* raindrop);
-void render();
-void render_weather_info();
+void update_weather_and_wind(const FrameTime* ft);
+void update_thunder(const FrameTime* ft);
+void update_spawning(const FrameTime* ft);
+void build_simulation_graph(TaskGraph* graph);
+void simulate_step(const FrameTime* ft);
+void integrate_raindrops(int begin, int end, float delta_time, float wind_effect,
+                         const float* jitter, float jitter_scale);
+void build_collision_grid(Uint32 current_time);
+bool check_raindrop_collision(int index, CollisionHit* hit);
+void render(const FrameTime* ft);
+void render_weather_info(const FrameTime* ft);
 SDL_Color get_random_color();
+void rng_seed(Rng* rng, Uint64 seed, Uint64 stream);
+Uint32 rng_next(Rng* rng);
+int rng_int(Rng* rng, int n);
+float rng_float(Rng* rng);
+void rng_bulk_seed(RngBulk* bulk, Rng* source);
+void rng_fill_floats(RngBulk* bulk, float* out, int count, float lo, float hi);
+void seed_random_streams(Uint64 seed);
+void init_sin_table();
+float fast_sinf(float x);      // 多项式正弦/余弦，误差见实现处的说明
+float fast_cosf(float x);
+float table_sinf(float x);     // 查表插值正弦/余弦，精度较低，用于动画
+float table_cosf(float x);
+void fast_sinf_array(const float* x, float* out, int n);
+void fast_cosf_array(const float* x, float* out, int n);
 float get_z_scale(float z);    // 根据z坐标获取缩放比例
 float project_x(float x, float z); // 根据z坐标投影x坐标
 SDL_Color adjust_color_by_depth(SDL_Color color, float z); // 根据深度调整颜色
 float get_rain_interval(WeatherState weather, int intensity); // 根据天气和强度获取雨滴间隔
 
+// ==== 平台层：与操作系统相关的代码集中在这里 ====
+#ifdef _WIN32
 // Set console code page to UTF-8 or GBK
 void setConsoleCodePage() {
     // Use UTF-8 code page (65001)
@@ -256,18 +880,256 @@ void setConsoleCodePage() {
     // SetConsoleOutputCP(936);
 }
 
-int main(int argc, char* args[]) {
-    /* allocate a terminal for this GUI program */
-    AllocConsole();    
-    setConsoleCodePage();
-    freopen("CONIN$", "r", stdin);
-    freopen("CONOUT$", "w", stdout);
-    freopen("CONOUT$", "w", stderr);
+// 图形界面程序没有控制台，分配一个用于输出提示和性能数据
+// 无界面模式通常由脚本启动并重定向输出，保留继承的标准输出
+void platform_init_console(bool headless) {
+    if (!headless) {
+        /* allocate a terminal for this GUI program */
+        AllocConsole();    
+        setConsoleCodePage();
+        freopen("CONIN$", "r", stdin);
+        freopen("CONOUT$", "w", stdout);
+        freopen("CONOUT$", "w", stderr);
+    }
+    setvbuf(stdout, NULL, _IONBF, 0);
+    setvbuf(stderr, NULL, _IONBF, 0);
+}
+
+// 只读映射整个文件，返回首地址并写入文件大小；文件不存在或为空时返回NULL
+const void* platform_map_file(const char* path, size_t* size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    const void* data = NULL;
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        // 映射视图建立后即可关闭文件和映射对象的句柄
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = (size_t)file_size.QuadPart;
+    }
+    CloseHandle(file);
+    return data;
+}
+
+void platform_unmap_file(const void* data, size_t size) {
+    (void)size;
+    UnmapViewOfFile(data);
+}
+
+// 用新写好的文件替换旧文件（目标文件不能处于映射状态）
+bool platform_replace_file(const char* from, const char* to) {
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+#else
+void platform_init_console(bool headless) {
+    (void)headless;
     setvbuf(stdout, NULL, _IONBF, 0);
     setvbuf(stderr, NULL, _IONBF, 0);
+}
+
+const void* platform_map_file(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    void* data = NULL;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) data = NULL;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return data;
+}
+
+void platform_unmap_file(const void* data, size_t size) {
+    munmap((void*)data, size);
+}
+
+bool platform_replace_file(const char* from, const char* to) {
+    return rename(from, to) == 0;
+}
+#endif
+
+void print_usage() {
+    printf("用法: NightRain [选项]\n");
+    printf("  --headless           无界面模式：离屏视频驱动，软件渲染到内存表面，不限帧率\n");
+    printf("  --frames <n>         运行 n 帧后退出（默认一直运行）\n");
+    printf("  --width <w>          输出宽度（默认 %d）\n", DEFAULT_WINDOW_WIDTH);
+    printf("  --height <h>         输出高度（默认 %d）\n", DEFAULT_WINDOW_HEIGHT);
+    printf("  --render-scale <s>   内部渲染分辨率占输出的比例，0.1-1（默认1），线性放大到输出\n");
+    printf("  --frame-budget <ms>  画质调节器的帧预算，超出时自动降低画质；0为关闭\n");
+    printf("                       （默认窗口模式 %.1fms，无界面模式关闭）\n", 1000.0 / 60);
+    printf("  --weather <天气>      初始天气：light/medium/heavy/storm 或 1-4\n");
+    printf("  --seed <n>           随机种子，相同种子产生相同画面\n");
+    printf("  --no-audio           不打开音频设备\n");
+    printf("  --screenshot <文件>   最后一帧保存为BMP（需配合 --frames）\n");
+    printf("  --max-raindrops <n>  雨滴池容量（默认 %d，每个约 %d 字节）\n", DEFAULT_MAX_RAINDROPS, (int)RAINDROP_BYTES);
+    printf("  --max-ripples <n>    涟漪池容量（默认 %d，每个 %d 字节）\n", DEFAULT_MAX_RIPPLES, (int)sizeof(Ripple));
+    printf("  --max-splashes <n>   水珠池容量（默认 %d，每个 %d 字节）\n", DEFAULT_MAX_SPLASHES, (int)sizeof(Splash));
+    printf("  --stars <n>          星星数量（默认 %d）\n", DEFAULT_STARS_COUNT);
+    printf("  --lotus-pads <n>     荷叶数量（默认 %d，每片荷叶一张纹理）\n", DEFAULT_LOTUS_PAD_COUNT);
+    printf("  --sdl-raster         软件渲染时不使用多线程平铺光栅化，全部交给SDL绘制\n");
+    printf("  --no-texture-cache   不读写程序化纹理的磁盘缓存（%s）\n", TEXTURE_CACHE_PATH);
+    printf("  --help               显示本帮助\n");
+}
+
+// 解析命令行参数；遇到无效参数时返回false，并记录在 opt->bad_arg
+bool parse_options(int argc, char* args[], AppOptions* opt) {
+    static const char* weather_names[WEATHER_COUNT] = {"light", "medium", "heavy", "storm"};
+    
+    opt->headless = false;
+    opt->audio = true;
+    opt->help = false;
+    opt->frames = 0;
+    opt->width = DEFAULT_WINDOW_WIDTH;
+    opt->height = DEFAULT_WINDOW_HEIGHT;
+    opt->render_scale = 1.0f;
+    opt->frame_budget = -1.0f;
+    opt->weather = -1;
+    opt->seed = (Uint64)time(NULL);
+    opt->screenshot = NULL;
+    opt->bad_arg = NULL;
+    opt->max_raindrops = DEFAULT_MAX_RAINDROPS;
+    opt->max_ripples = DEFAULT_MAX_RIPPLES;
+    opt->max_splashes = DEFAULT_MAX_SPLASHES;
+    opt->stars = DEFAULT_STARS_COUNT;
+    opt->lotus_pads = DEFAULT_LOTUS_PAD_COUNT;
+    opt->sdl_raster = false;
+    opt->texture_cache = true;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* arg = args[i];
+        const char* value = i + 1 < argc ? args[i + 1] : NULL;
+        
+        if (strcmp(arg, "--headless") == 0) {
+            opt->headless = true;
+        } else if (strcmp(arg, "--no-audio") == 0) {
+            opt->audio = false;
+        } else if (strcmp(arg, "--sdl-raster") == 0) {
+            opt->sdl_raster = true;
+        } else if (strcmp(arg, "--no-texture-cache") == 0) {
+            opt->texture_cache = false;
+        } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            opt->help = true;
+        } else if (strcmp(arg, "--frames") == 0 && value) {
+            opt->frames = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--width") == 0 && value) {
+            opt->width = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--height") == 0 && value) {
+            opt->height = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--render-scale") == 0 && value) {
+            opt->render_scale = (float)atof(value);
+            i++;
+        } else if (strcmp(arg, "--frame-budget") == 0 && value) {
+            opt->frame_budget = (float)atof(value);
+            if (opt->frame_budget < 0.0f) {
+                opt->bad_arg = arg;
+                return false;
+            }
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            opt->seed = strtoull(value, NULL, 0);
+            i++;
+        } else if (strcmp(arg, "--max-raindrops") == 0 && value) {
+            opt->max_raindrops = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--max-ripples") == 0 && value) {
+            opt->max_ripples = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--max-splashes") == 0 && value) {
+            opt->max_splashes = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--stars") == 0 && value) {
+            opt->stars = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--lotus-pads") == 0 && value) {
+            opt->lotus_pads = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--screenshot") == 0 && value) {
+            opt->screenshot = value;
+            i++;
+        } else if (strcmp(arg, "--weather") == 0 && value) {
+            for (int w = 0; w < WEATHER_COUNT; w++) {
+                if (strcmp(value, weather_names[w]) == 0 || atoi(value) == w + 1) {
+                    opt->weather = w;
+                }
+            }
+            if (opt->weather < 0) {
+                opt->bad_arg = value;
+                return false;
+            }
+            i++;
+        } else {
+            opt->bad_arg = arg;
+            return false;
+        }
+    }
+    
+    if (opt->frames < 0 || opt->width <= 0 || opt->height <= 0) {
+        opt->bad_arg = opt->frames < 0 ? "--frames" : (opt->width <= 0 ? "--width" : "--height");
+        return false;
+    }
+    if (opt->width > MAX_WINDOW_SIZE) opt->bad_arg = "--width";
+    if (opt->height > MAX_WINDOW_SIZE) opt->bad_arg = "--height";
+    if (!(opt->render_scale >= 0.1f && opt->render_scale <= 1.0f)) opt->bad_arg = "--render-scale";
+    // 容量至少为1，上限避免 int 下标和内存大小溢出
+    if (opt->max_raindrops < 1 || opt->max_raindrops > MAX_POOL_CAPACITY) opt->bad_arg = "--max-raindrops";
+    if (opt->max_ripples < 1 || opt->max_ripples > MAX_POOL_CAPACITY) opt->bad_arg = "--max-ripples";
+    if (opt->max_splashes < 1 || opt->max_splashes > MAX_POOL_CAPACITY) opt->bad_arg = "--max-splashes";
+    if (opt->stars < 0 || opt->stars > MAX_POOL_CAPACITY) opt->bad_arg = "--stars";
+    if (opt->lotus_pads < 0 || opt->lotus_pads > 10000) opt->bad_arg = "--lotus-pads";
+    return opt->bad_arg == NULL;
+}
+
+// 把当前渲染结果保存为BMP，须在 SDL_RenderPresent 之前调用
+bool save_screenshot(const char* path) {
+    int w, h;
+    if (SDL_GetRendererOutputSize(output_renderer, &w, &h) < 0) {
+        printf("无法获取渲染尺寸! SDL错误: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_Surface* shot = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (shot == NULL) {
+        printf("无法创建截图表面! SDL错误: %s\n", SDL_GetError());
+        return false;
+    }
+    bool ok = SDL_RenderReadPixels(output_renderer, NULL, SDL_PIXELFORMAT_ARGB8888, shot->pixels, shot->pitch) == 0 &&
+              SDL_SaveBMP(shot, path) == 0;
+    if (ok) {
+        printf("截图已保存: %s\n", path);
+    } else {
+        printf("无法保存截图! SDL错误: %s\n", SDL_GetError());
+    }
+    SDL_FreeSurface(shot);
+    return ok;
+}
+
+int main(int argc, char* args[]) {
+    bool options_ok = parse_options(argc, args, &options);
+    platform_init_console(options.headless);
+    if (!options_ok) {
+        printf("无效参数: %s\n", options.bad_arg);
+        print_usage();
+        return 1;
+    }
+    if (options.help) {
+        print_usage();
+        return 0;
+    }
 
-    // 初始化随机数种子
-    srand(time(NULL));
+    // 启动计时：各阶段耗时在进入主循环前打印
+    perf.freq = SDL_GetPerformanceFrequency();
+    startup_timing.start = SDL_GetPerformanceCounter();
+    
+    // 初始化随机数种子：--seed 指定时结果可复现，否则使用当前时间
+    seed_random_streams(options.seed);
+    printf("随机种子: %llu\n", (unsigned long long)options.seed);
     
     // 初始化SDL和资源
     if (!initialize()) {
@@ -276,6 +1138,7 @@ int main(int argc, char* args[]) {
         printf("如果您在Windows下使用VSCode，请参考之前的配置说明。\n");
         return -1;
     }
+    startup_timing.sdl_init = (SDL_GetPerformanceCounter() - startup_timing.start) * 1000.0 / perf.freq;
     
     // 显示使用说明
     printf("\nRainbow Rain in Nighty Pond\n");
@@ -298,23 +1161,33 @@ int main(int argc, char* args[]) {
     // 事件处理器
     SDL_Event e;
     
-    // 设置上一次雨滴生成时间为当前时间
-    last_raindrop_time = SDL_GetTicks();
-    last_weather_change_time = SDL_GetTicks();
-    last_lightning_time = SDL_GetTicks();
-    last_thunder_time = SDL_GetTicks();
+    // 模拟时钟从0开始，各计时器以模拟时间为准
+    rain_spawn_debt = 0.0f;
+    last_weather_change_time = 0;
+    last_lightning_time = 0;
+    last_thunder_time = 0;
+    if (options.weather >= 0) {
+        target_weather = (WeatherState)options.weather;
+    }
     
-    // 初始化各种元素
-    initialize_moon();
-    initialize_cloud();
-    initialize_stars();
-    initialize_mountains();
-    initialize_reeds();
-    initialize_lotus_pads();
-    initialize_lotus_flowers();
+    // 初始化各种元素：纹理由工作线程并行生成，同时等待后台的音频加载
+    init_sin_table();
+    if (!initialize_scene()) {
+        printf("初始化失败!\n");
+        close_app();
+        return -1;
+    }
+    finish_audio_loading();
+    startup_timing.total = (SDL_GetPerformanceCounter() - startup_timing.start) * 1000.0 / perf.freq;
+    print_startup_timing();
     
-    // 时间跟踪
-    Uint32 last_frame_time = SDL_GetTicks();
+    // 时间跟踪：用64位性能计数器累积真实时间，按固定步长推进模拟
+    FrameTime frame = {0};
+    frame.delta_time = 1.0f / SIM_STEP_HZ;
+    Uint64 step_counts = perf.freq / SIM_STEP_HZ;   // 每个模拟步对应的计数器增量
+    Uint64 accumulator = 0;
+    Uint64 last_counter = SDL_GetPerformanceCounter();
+    perf.run_start = last_counter;
 
     // load bgm
     if(bgm_music != NULL) {
@@ -324,13 +1197,17 @@ int main(int argc, char* args[]) {
     
     // 主循环
     while (!quit) {
-        /* record the time this frame starts */
-        perf.frame_start = SDL_GetPerformanceCounter();
-
-        // 当前时间和时间增量
-        Uint32 current_time = SDL_GetTicks();
-        float delta_time = (current_time - last_frame_time) / 1000.0f;
-        last_frame_time = current_time;
+        /* record the time this frame starts - the only clock read this frame */
+        frame.counter = SDL_GetPerformanceCounter();
+        perf.frame_start = frame.counter;
+        
+        // 累积经过的真实时间；卡顿过久时丢弃多余部分，避免补偿步数越积越多
+        // 无界面模式不等待真实时间，每帧固定推进一步，结果只取决于帧数和种子
+        accumulator += options.headless ? step_counts : frame.counter - last_counter;
+        last_counter = frame.counter;
+        if (accumulator > step_counts * SIM_MAX_STEPS_PER_FRAME) {
+            accumulator = step_counts * SIM_MAX_STEPS_PER_FRAME;
+        }
         
         /* ==== [1] tackle input events ====*/
         // 处理事件队列
@@ -340,6 +1217,11 @@ int main(int argc, char* args[]) {
             if (e.type == SDL_QUIT) {
                 quit = true;
             }
+            // 渲染目标纹理的内容丢失（如Direct3D设备重置），背景层需要重绘
+            else if (e.type == SDL_RENDER_TARGETS_RESET) {
+                sky_layer.valid = false;
+                mountain_layer.valid = false;
+            }
             // 用户按下按键
             else if (e.type == SDL_KEYDOWN) {
                 switch (e.key.keysym.sym) {
@@ -375,11 +1257,11 @@ int main(int argc, char* args[]) {
                     case SDLK_SPACE:
                         // 手动触发闪电和雷声
                         if (current_weather >= WEATHER_HEAVY_RAIN) {
-                            int x = WINDOW_WIDTH / 2 + (rand() % 300) - 150;
-                            create_lightning(x, 0, 5 + rand() % 10, 2 + rand() % 3, 0);
+                            int x = window_width / 2 + rng_int(&lightning_rng, 300) - 150;
+                            create_lightning(x, 0, 5 + rng_int(&lightning_rng, 10), 2 + rng_int(&lightning_rng, 3), 0, frame.ms);
                             thunder_active = true;
-                            thunder_start_time = current_time;
-                            thunder_duration = 1000 + rand() % 2000;
+                            thunder_start_time = frame.ms;
+                            thunder_duration = 1000 + rng_int(&lightning_rng, 2000);
                         }
                         break;
                     case SDLK_LEFT:
@@ -403,160 +1285,240 @@ int main(int argc, char* args[]) {
         perf.input_time = (SDL_GetPerformanceCounter() - input_start) * 1000.0 / perf.freq;
         
         /* ==== [2] unpdate physical system */
+        // 以固定步长推进模拟，本帧可能执行0到 SIM_MAX_STEPS_PER_FRAME 步
         Uint64 physics_start = SDL_GetPerformanceCounter();
-        // 更新天气和风系统
-        update_weather_and_wind(current_time);
-        // 更新雷声
-        update_thunder(current_time);
-        // 如果达到生成间隔，创建新雨滴
-        raindrop_interval = get_rain_interval(current_weather, weather_intensity);
-        if (current_time - last_raindrop_time >= raindrop_interval) {
-            // 根据rain_surface_ratio决定雨滴是直接落在水面还是从天空落下
-            bool on_surface = ((float)rand() / RAND_MAX) < rain_surface_ratio;
-            create_raindrop(on_surface);
-            last_raindrop_time = current_time;
-        } 
-        // 在雷暴天气下，随机产生闪电
-        if ((current_weather == WEATHER_THUNDERSTORM || 
-             (current_weather == WEATHER_HEAVY_RAIN && weather_intensity > 70)) && 
-            current_time - last_lightning_time > (10000 - weather_intensity * 80)) {            
-            // 闪电出现概率随强度增加
-            if (rand() % 100 < weather_intensity / 5) {
-                int x = WINDOW_WIDTH / 2 + (rand() % 400) - 200;
-                create_lightning(x, 0, 5 + rand() % 10, 2 + rand() % 3, 0);                
-                // 随机产生雷声
-                if (rand() % 100 < 50) {
-                    thunder_active = true;
-                    thunder_start_time = current_time + 500 + rand() % 1000; // 闪电后延迟出现雷声
-                    thunder_duration = 1000 + rand() % 2000;
-                }                
-                last_lightning_time = current_time;
-            }
+        perf.sim_steps = 0;
+        perf.critical_path_time = 0.0;
+        for (int i = 0; i < perf.task_count; i++) {
+            perf.task_time[i] = 0.0;
         }
-        // 更新所有元素
-        update_raindrops(current_time, delta_time);
-        update_ripples(current_time);
-        update_splashes(current_time, delta_time);
-        update_lightning(current_time);
-        update_stars(current_time);
-        update_lotus_pads(current_time, delta_time);
-        update_lotus_flowers(current_time, delta_time);
-        update_camera();
+        while (accumulator >= step_counts) {
+            frame.sim_ticks++;
+            frame.ms = (Uint32)(frame.sim_ticks * 1000 / SIM_STEP_HZ);
+            simulate_step(&frame);
+            accumulator -= step_counts;
+            perf.sim_steps++;
+        }
+        // 渲染位于上一步与当前步之间：alpha 为剩余累积时间占一步的比例
+        frame.alpha = (float)accumulator / step_counts;
+        Uint32 lag_ms = (Uint32)((1.0f - frame.alpha) * 1000.0f / SIM_STEP_HZ);
+        frame.render_ms = frame.ms > lag_ms ? frame.ms - lag_ms : 0;
         perf.physics_time = (SDL_GetPerformanceCounter() - physics_start) * 1000.0 / perf.freq;
+        
+        // 本帧模拟产生的落水统计交给雨声合成器，雷声在此播放
+        flush_audio_voices(perf.sim_steps * frame.delta_time);
 
         /* ==== [3] rendering ==== */
         Uint64 rander_start = SDL_GetPerformanceCounter();
-        // 清屏
+        // 清屏（降分辨率渲染时上一帧呈现后已切回输出，先回到离屏目标）
+        if (scene_target) {
+            set_scene_render_target(NULL);
+        }
         SDL_SetRenderDrawColor(renderer, 0, 0, 20, 255); // 深蓝色夜空
         SDL_RenderClear(renderer);        
         // 渲染所有元素
-        render();        
+        render(&frame);        
+        // 平铺光栅化后端：把内存中的场景帧交给输出渲染器
+        present_soft_raster();
+        // 降分辨率渲染：把离屏目标线性放大到输出
+        present_scene_target();
+        // 最后一帧按需保存截图（必须在呈现之前读取像素）
+        bool last_frame = options.frames > 0 && perf.frame_count + 1 >= options.frames;
+        if (last_frame && options.screenshot) {
+            save_screenshot(options.screenshot);
+        }
         // 更新屏幕
-        SDL_RenderPresent(renderer); 
+        Uint64 present_start = SDL_GetPerformanceCounter();
+        SDL_RenderPresent(output_renderer); 
         perf.render_time = (SDL_GetPerformanceCounter() - rander_start) * 1000.0 / perf.freq;
+        perf.work_time = perf.input_time + perf.physics_time + (present_start - rander_start) * 1000.0 / perf.freq;
 
         /* ==== [4] compute performance data ==== */
         perf.frame_end = SDL_GetPerformanceCounter();
         perf.frame_time = (perf.frame_end - perf.frame_start) * 1000.0 / perf.freq; // 转换为毫秒
         perf.avg_frame_time = perf.avg_frame_time * 0.9 + perf.frame_time * 0.1; // 滑动平均
         perf.frame_count++;
+        perf.physics_total += perf.physics_time;
+        perf.render_total += perf.render_time;
+        // 按本帧工作耗时调整下一帧的画质
+        update_quality_governor(perf.work_time);
+        if (last_frame) {
+            quit = true;
+        }
         if (perf.frame_count % 60 == 0) { //output performance data every 60 frames
-            printf("[Frame %d] Total: %.1fms (Phys:%.1fms Render:%.1fms Input:%.1fms) FPS: %.1f\n",
+            printf("[Frame %d] Total: %.1fms (Phys:%.1fms/%d steps Render:%.1fms Input:%.1fms) FPS: %.1f\n",
                perf.frame_count,
                perf.avg_frame_time,
                perf.physics_time,
+               perf.sim_steps,
                perf.render_time,
                perf.input_time,
                1000.0 / perf.avg_frame_time);
+            // 各模拟任务耗时，关键路径即并行执行的理论下限
+            printf("  Tasks: critical path %.2fms |", perf.critical_path_time);
+            for (int i = 0; i < perf.task_count; i++) {
+                printf(" %s %.2f", perf.task_names[i], perf.task_time[i]);
+            }
+            printf("\n");
+            if (quality.enabled) {
+                printf("  Quality: level %d/%d (budget %.1fms, avg work %.1fms, render scale %.2f)\n",
+                       quality.level, QUALITY_LEVELS - 1, quality.budget_ms, quality.avg_work, render_scale);
+            }
         }
 
-        // 限制帧率为60 FPS
-        SDL_Delay(1000 / 60);
+        // 限制帧率为60 FPS（无界面模式全速运行以测量吞吐量）
+        if (!options.headless) {
+            SDL_Delay(1000 / 60);
+        }
+    }
+    
+    // 输出整体吞吐量
+    if (perf.frame_count > 0) {
+        double total_ms = (SDL_GetPerformanceCounter() - perf.run_start) * 1000.0 / perf.freq;
+        printf("共 %d 帧，用时 %.2fs，平均 %.1f FPS（物理 %.2fms/帧，渲染 %.2fms/帧）\n",
+               perf.frame_count, total_ms / 1000.0, perf.frame_count * 1000.0 / total_ms,
+               perf.physics_total / perf.frame_count, perf.render_total / perf.frame_count);
+        if (rain_synth.enabled) printf("雨声：合成 %d 次落水\n", audio_voices.impacts_total);
+        print_quality_summary();
     }
     
     // 释放资源并关闭SDL
-    close();
+    close_app();
     
     return 0;
 }
 
 bool initialize() {
     // 初始化SDL
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
-        printf("SDL无法初始化! SDL错误: %s\n", SDL_GetError());
-        return false;
+    Uint32 init_flags = SDL_INIT_VIDEO;
+    if (options.audio) init_flags |= SDL_INIT_AUDIO;
+    if (options.headless) {
+        // 无显示环境：离屏视频驱动，音频输出到空设备（环境变量 SDL_VIDEODRIVER/SDL_AUDIODRIVER 优先）
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+        SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
     }
-    
-    // 创建窗口
-    window = SDL_CreateWindow("池塘夜降彩色雨", 
-                             SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 
-                             WINDOW_WIDTH, WINDOW_HEIGHT, 
-                             SDL_WINDOW_SHOWN);
-    if (window == NULL) {
-        printf("无法创建窗口! SDL错误: %s\n", SDL_GetError());
-        return false;
+    if (SDL_Init(init_flags) < 0) {
+        if (!options.headless) {
+            printf("SDL无法初始化! SDL错误: %s\n", SDL_GetError());
+            return false;
+        }
+        // 较旧的SDL没有offscreen驱动，退回dummy驱动
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        if (SDL_Init(init_flags) < 0) {
+            printf("SDL无法初始化! SDL错误: %s\n", SDL_GetError());
+            return false;
+        }
     }
     
-    // 创建渲染器 - 尝试使用硬件加速
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    if (renderer == NULL) {
-        printf("警告：无法创建硬件加速渲染器，尝试创建软件渲染器...\n");
-        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
-        
+    if (options.headless) {
+        // 无界面模式：软件渲染器直接绘制到内存表面，不创建窗口
+        headless_surface = SDL_CreateRGBSurfaceWithFormat(0, options.width, options.height, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (headless_surface == NULL) {
+            printf("无法创建离屏表面! SDL错误: %s\n", SDL_GetError());
+            return false;
+        }
+        renderer = SDL_CreateSoftwareRenderer(headless_surface);
         if (renderer == NULL) {
-            printf("无法创建任何渲染器! SDL错误: %s\n", SDL_GetError());
+            printf("无法创建软件渲染器! SDL错误: %s\n", SDL_GetError());
             return false;
         }
-        printf("成功创建软件渲染器。\n");
+        printf("无界面模式：软件渲染到 %dx%d 内存表面（视频驱动 %s）。\n",
+               options.width, options.height, SDL_GetCurrentVideoDriver());
     } else {
-        printf("成功创建硬件加速渲染器。\n");
+        // 创建窗口
+        window = SDL_CreateWindow("池塘夜降彩色雨", 
+                                 SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 
+                                 options.width, options.height, 
+                                 SDL_WINDOW_SHOWN);
+        if (window == NULL) {
+            printf("无法创建窗口! SDL错误: %s\n", SDL_GetError());
+            return false;
+        }
+        
+        // 创建渲染器 - 尝试使用硬件加速
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        if (renderer == NULL) {
+            printf("警告：无法创建硬件加速渲染器，尝试创建软件渲染器...\n");
+            renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+            
+            if (renderer == NULL) {
+                printf("无法创建任何渲染器! SDL错误: %s\n", SDL_GetError());
+                return false;
+            }
+            printf("成功创建软件渲染器。\n");
+        } else {
+            printf("成功创建硬件加速渲染器。\n");
+        }
+    }
+    
+    // 场景以输出分辨率为坐标系布局；内部按 render_scale 降低分辨率绘制，呈现时线性放大到输出
+    output_renderer = renderer;
+    window_width = options.width;
+    window_height = options.height;
+    pond_height = window_height * 2 / 3;
+    render_scale = options.render_scale;
+    render_width = (int)ceilf(window_width * render_scale);
+    render_height = (int)ceilf(window_height * render_scale);
+    
+    // 软件渲染（含无界面模式）时启用平铺光栅化后端，场景改为绘制到内存帧
+    SDL_RendererInfo renderer_info;
+    bool software = options.headless ||
+                    (SDL_GetRendererInfo(output_renderer, &renderer_info) == 0 &&
+                     (renderer_info.flags & SDL_RENDERER_SOFTWARE));
+    // 画质调节器降低渲染比例时才按需创建离屏帧，见 apply_render_scale
+    init_quality_governor();
+    if (software && !options.sdl_raster && init_soft_raster()) {
+        renderer = soft_raster.scene_renderer;
+    } else if (render_scale < 1.0f) {
+        init_scene_target();
+    }
+    if (render_scale < 1.0f) {
+        printf("场景 %dx%d，内部渲染分辨率 %dx%d（%.0f%%）。\n",
+               window_width, window_height, render_width, render_height, render_scale * 100.0f);
     }
     
     // 设置渲染器混合模式
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
 
-    // initialize SDL_mixer for audio
-    if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        printf("SDL_mixer初始化失败! 错误: %s\n", Mix_GetError());
-        return false;
-    }
+    if (options.audio) {
+        // initialize SDL_mixer for audio
+        if(Mix_OpenAudio(AUDIO_SAMPLE_RATE, MIX_DEFAULT_FORMAT, 2, AUDIO_BUFFER_FRAMES) < 0) {
+            printf("SDL_mixer初始化失败! 错误: %s\n", Mix_GetError());
+            return false;
+        }
 
-    // load audio
-    bgm_music = Mix_LoadMUS("./audio/bgm.mp3");
-    if(!bgm_music) {
-        printf("无法加载背景音乐! 错误: %s\n", Mix_GetError());
-        // 注意：这里不返回错误，即使音乐加载失败程序仍然可以运行
-    }
-    splash_sound = Mix_LoadWAV("./audio/splash.wav");
-    if(!splash_sound) {
-        printf("无法加载音效! 错误: %s\n", Mix_GetError());
-        return false;
-    }
-    lightning_sound = Mix_LoadWAV("./audio/lightning.wav");
-    if(!splash_sound) {
-        printf("无法加载音效! 错误: %s\n", Mix_GetError());
-        return false;
-    }
-    
-    // 初始化各种元素数组
-    for (int i = 0; i < MAX_RAINDROPS; i++) {
-        raindrops[i].active = false;
+        // load audio：在后台解码，进入主循环前由 finish_audio_loading 等待
+        start_audio_loading();
+        
+        // 雨声和雷声都在后期混音中生成，不使用采样通道
+        Mix_AllocateChannels(0);
+        init_rain_synth();
+    } else {
+        printf("音频已禁用。\n");
     }
     
-    for (int i = 0; i < MAX_RIPPLES; i++) {
-        ripples[i].active = false;
+    // 按容量分配粒子池
+    if (!allocate_pools()) {
+        return false;
     }
     
-    for (int i = 0; i < MAX_SPLASHES; i++) {
-        splashes[i].active = false;
-    }
+    // 初始化各种元素数组（粒子池为空：存活计数清零即可）
+    raindrop_count = 0;
+    ripple_count = 0;
+    splash_count = 0;
     
     for (int i = 0; i < MAX_LIGHTNING; i++) {
         lightnings[i].active = false;
     }
 
+    // 物理工作线程：主线程之外每个CPU核心一个
+    if (!init_worker_pool(SDL_GetCPUCount() - 1)) {
+        return false;
+    }
+    printf("物理计算使用 %d 个线程。\n", worker_pool.thread_count + 1);
+    build_simulation_graph(&sim_graph);
+
     /* initialize performance monitor */
-    perf.freq = SDL_GetPerformanceFrequency();
     perf.avg_frame_time = 0.0;
     perf.frame_count = 0;
     
@@ -564,7 +1526,9 @@ bool initialize() {
     return true;
 }
 
-void close() {
+void close_app() {
+    shutdown_worker_pool();
+
     /* destroy textures */
     if (moon_texture != NULL) {
         SDL_DestroyTexture(moon_texture);
@@ -576,182 +1540,1757 @@ void close() {
             cloud_textures[i] = NULL;
         }
     }
+    if (ripple_atlas != NULL) {
+        SDL_DestroyTexture(ripple_atlas);
+        ripple_atlas = NULL;
+    }
+    if (lightning_glow != NULL) {
+        SDL_DestroyTexture(lightning_glow);
+        lightning_glow = NULL;
+    }
+    for (int i = 0; i < MOUNTAIN_COUNT; i++) {
+        if (mountains[i].texture) {
+            SDL_DestroyTexture(mountains[i].texture);
+            mountains[i].texture = NULL;
+        }
+    }
     destroy_lotus_textures();
+    destroy_flower_textures();
+    destroy_background_layer(&sky_layer);
+    destroy_background_layer(&mountain_layer);
+    free_pools();
 
     /* destroy audio*/
-    if(splash_sound != NULL) {
-        Mix_FreeChunk(splash_sound);
-        splash_sound = NULL;
+    if (audio_loader) {
+        SDL_WaitThread(audio_loader, NULL);
+        audio_loader = NULL;
     }
-    if(lightning_sound != NULL) {
-        Mix_FreeChunk(lightning_sound);
-        lightning_sound = NULL;
+    if (rain_synth.enabled) {
+        Mix_SetPostMix(NULL, NULL);
+        rain_synth.enabled = false;
+    }
+    free_thunder_sound();
+    if (options.audio) {
+        Mix_CloseAudio();
     }
-    Mix_CloseAudio();
     if(bgm_music != NULL) {
         Mix_FreeMusic(bgm_music);
         bgm_music = NULL;
     }
     
     // 销毁渲染器和窗口
-    if (renderer != NULL) {
-        SDL_DestroyRenderer(renderer);
-        renderer = NULL;
+    if (scene_target != NULL) {
+        SDL_DestroyTexture(scene_target);
+        scene_target = NULL;
+    }
+    shutdown_soft_raster();
+    if (output_renderer != NULL) {
+        SDL_DestroyRenderer(output_renderer);
+        output_renderer = NULL;
     }
+    renderer = NULL;
     
     if (window != NULL) {
         SDL_DestroyWindow(window);
         window = NULL;
     }
+    if (headless_surface != NULL) {
+        SDL_FreeSurface(headless_surface);
+        headless_surface = NULL;
+    }
     
     // 退出SDL子系统
     SDL_Quit();
 }
 
-void draw_crater(SDL_Surface* surface, int cx, int cy, int radius, Uint32 color) {
-    for (int y = -radius; y <= radius; y++) {
-        for (int x = -radius; x <= radius; x++) {
-            if (x*x + y*y <= radius*radius) {
-                int px = cx + x;
-                int py = cy + y;
-                if (px >= 0 && px < surface->w && py >= 0 && py < surface->h) {
-                    ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = color;
-                }
-            }
-        }
+// ==== 启动流水线 ====
+// 场景参数在主线程按固定顺序生成（只有这一步消耗 scene_rng），程序化表面由工作线程并行绘制，
+// 纹理只能在渲染线程创建，最后按登记顺序逐个上传；音频同时在后台线程加载
+
+// 音频加载线程：SDL的错误信息按线程保存，失败原因在本线程打印
+static int SDLCALL audio_loader_main(void* data) {
+    (void)data;
+    Uint64 start = SDL_GetPerformanceCounter();
+    bgm_music = Mix_LoadMUS("./audio/bgm.mp3");
+    if(!bgm_music) {
+        printf("无法加载背景音乐! 错误: %s\n", Mix_GetError());
+        // 注意：这里不返回错误，即使音乐加载失败程序仍然可以运行
     }
+    // 雷声只解析文件头，样本在第一次大雨时才开始解码
+    open_sound_stream(&thunder.stream, "./audio/lightning.wav");
+    startup_timing.audio_decode = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+    return 0;
 }
 
-void create_raindrop(bool on_surface) {
-    // 查找一个未激活的雨滴槽位
-    for (int i = 0; i < MAX_RAINDROPS; i++) {
-        if (!raindrops[i].active) {
-            raindrops[i].active = true;
-            raindrops[i].z = (float)rand() / RAND_MAX; // 随机深度 (0-1)
-            
-            // 根据深度，远处雨滴位置范围更大，模拟宽视场
-            float z_width_scale = 1.0f + (1.0f - raindrops[i].z) * 2.0f;
-            raindrops[i].x = (rand() % (int)(WINDOW_WIDTH * z_width_scale)) - 
-                              ((z_width_scale - 1.0f) * WINDOW_WIDTH / 2);
-            
-            if (on_surface) {
-                // 直接在水面随机位置生成雨滴
-                raindrops[i].y = POND_HEIGHT + rand() % (WINDOW_HEIGHT - POND_HEIGHT);
-                raindrops[i].in_water = true;
-                raindrops[i].water_time = SDL_GetTicks();
-                
-                // 创建涟漪
-                create_ripple(raindrops[i].x, raindrops[i].y, raindrops[i].z, raindrops[i].color);
-            } else {
-                // 在天空生成雨滴
-                raindrops[i].in_water = false;
-                raindrops[i].y = -10 - rand() % 50;  // 从窗口上方不同高度开始
-            }
-            
-            // 远处的雨滴看起来应该下落得更慢
-            float z_speed_scale = 0.2f + raindrops[i].z * 0.8f;
-            
-            // 根据天气强度调整下落速度
-            float intensity_factor = 1.0f + (weather_intensity / 100.0f);
-            
-            raindrops[i].speed_y = (RAINDROP_FALL_SPEED_MIN + 
-                                  (float)rand() / RAND_MAX * (RAINDROP_FALL_SPEED_MAX - RAINDROP_FALL_SPEED_MIN)) * 
-                                  z_speed_scale * intensity_factor;
-            
-            // 初始水平速度受风影响
-            raindrops[i].speed_x = wind_strength * 50.0f * z_speed_scale * intensity_factor;
-            
-            raindrops[i].color = get_random_color();
-            raindrops[i].size = 2 + rand() % 5;  // 基础大小在2到6之间
-            raindrops[i].creation_time = SDL_GetTicks();
-            raindrop_count++;
-            return;
-        }
+// 在后台线程加载背景音乐和雷声，与纹理生成同时进行；无法创建线程时直接加载
+void start_audio_loading() {
+    audio_loader = SDL_CreateThread(audio_loader_main, "audio-loader", NULL);
+    if (!audio_loader) {
+        printf("警告：无法创建音频加载线程，改为同步加载! SDL错误: %s\n", SDL_GetError());
+        audio_loader_main(NULL);
     }
 }
 
-void create_ripple(float x, float y, float z, SDL_Color color) {
-    // 查找一个未激活的涟漪槽位
-    for (int i = 0; i < MAX_RIPPLES; i++) {
-        if (!ripples[i].active) {
-            ripples[i].active = true;
-            ripples[i].x = x;
-            ripples[i].y = y;
-            ripples[i].z = z;
-            ripples[i].radius = 0;
-            // 远处的涟漪最大半径应该更小
-            float z_radius_scale = get_z_scale(z);
-            ripples[i].max_radius = (20 + rand() % 40) * z_radius_scale;
-            ripples[i].color = color;
-            ripples[i].creation_time = SDL_GetTicks();
-            ripple_count++;
-
-            // 播放音效
-            if(splash_sound != NULL) {
-                Mix_PlayChannel(-1, splash_sound, 0);
-            }
-            return;
-        }
+// 等待音频加载完成；雷声文件缺失或格式不支持时只是没有雷声，程序照常运行
+void finish_audio_loading() {
+    if (!options.audio) return;
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (audio_loader) {
+        SDL_WaitThread(audio_loader, NULL);
+        audio_loader = NULL;
+    }
+    startup_timing.audio_wait = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+    if (thunder.stream.file == NULL) {
+        printf("警告：雷声音频不可用，雷声已禁用\n");
     }
 }
 
-void create_splash(float x, float y, float z, SDL_Color color) {
-    // 创建多个溅射水珠
-    int splash_count = 5 + rand() % 8; // 5-12个水珠
-    
-    // 根据强度增加水珠数量
-    splash_count = (int)(splash_count * (1.0f + weather_intensity / 100.0f));
-    
-    for (int i = 0; i < splash_count; i++) {
-        // 查找未使用的溅射水珠槽位
-        for (int j = 0; j < MAX_SPLASHES; j++) {
-            if (!splashes[j].active) {
-                splashes[j].active = true;
-                splashes[j].x = x;
-                splashes[j].y = y;
-                splashes[j].z = z;
-                
-                // 随机速度方向，创造圆形溅射效果
-                float angle = ((float)rand() / RAND_MAX) * 6.28f; // 0-2π
-                
-                // 根据天气强度调整速度
-                float intensity_factor = 1.0f + (weather_intensity / 100.0f);
-                float speed = (50.0f + ((float)rand() / RAND_MAX) * 150.0f) * intensity_factor; // 50-200，受强度影响
-                
-                // 风会影响水珠方向
-                angle += wind_strength * 0.5f;
-                
-                splashes[j].speed_x = cosf(angle) * speed;
-                splashes[j].speed_y = sinf(angle) * speed - 200.0f; // 初始向上的趋势
-                
-                splashes[j].size = 1.0f + ((float)rand() / RAND_MAX) * 2.0f; // 1-3
-                splashes[j].color = color;
-                splashes[j].creation_time = SDL_GetTicks();
-                splash_count++;
-                break;
-            }
-        }
+// FNV-1a 散列，用于纹理缓存的键
+static Uint64 hash_bytes(Uint64 h, const void* data, size_t size) {
+    const Uint8* bytes = (const Uint8*)data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 1099511628211ULL;
     }
+    return h;
 }
 
-void create_lightning(int x, int y, int segments, int width, int type) {
-    // 查找未使用的闪电槽位
-    for (int i = 0; i < MAX_LIGHTNING; i++) {
-        if (!lightnings[i].active) {
+static Uint64 hash_int(Uint64 h, int v) {
+    return hash_bytes(h, &v, sizeof(v));
+}
+
+static Uint64 hash_float(Uint64 h, float v) {
+    return hash_bytes(h, &v, sizeof(v));
+}
+
+static Uint64 hash_color(Uint64 h, SDL_Color c) {
+    Uint8 rgba[4] = {c.r, c.g, c.b, c.a};
+    return hash_bytes(h, rgba, sizeof(rgba));
+}
+
+// 纹理缓存的键：影响纹理的常量和每个对象的生成参数，逐项散列（不含结构体填充字节）
+// 生成函数不使用随机数，种子只通过这些参数影响纹理，因此键中不含种子本身
+static Uint64 texture_cache_key() {
+    Uint64 h = 14695981039346656037ULL;
+    h = hash_int(h, window_width);
+    h = hash_int(h, MAX_CLOUD_LAYERS);
+    h = hash_int(h, RIPPLE_SPRITE_MAX_RADIUS);
+    h = hash_int(h, RIPPLE_SPRITE_ELLIPSE_STEPS);
+    h = hash_int(h, RIPPLE_ATLAS_WIDTH);
+    h = hash_int(h, LIGHTNING_GLOW_SIZE);
+    h = hash_int(h, LOTUS_FLOWER_FRAMES);
+    h = hash_int(h, LOTUS_FLOWER_FRAME_COLUMNS);
+    for (int i = 0; i < MOUNTAIN_COUNT; i++) {
+        h = hash_int(h, mountains[i].width);
+        h = hash_int(h, mountains[i].height);
+    }
+    h = hash_int(h, lotus_pad_count);
+    for (int i = 0; i < lotus_pad_count; i++) {
+        h = hash_float(h, lotus_pads[i].radius);
+        h = hash_color(h, lotus_pads[i].color);
+    }
+    for (int i = 0; i < LOTUS_FLOWER_COUNT; i++) {
+        h = hash_float(h, lotus_flowers[i].size);
+        h = hash_color(h, lotus_flowers[i].color);
+        h = hash_int(h, lotus_flowers[i].petal_count);
+    }
+    return h;
+}
+
+// 映射缓存文件并逐项校验；全部有效时为每个条目创建直接指向映射内存的表面（不复制像素）
+// 成功返回映射首地址，由调用者在上传纹理后解除映射；任何一项不符都返回NULL，改为重新生成
+static const void* load_texture_cache(StartupSurface* items, int count, Uint64 key, size_t* size) {
+    const Uint8* data = (const Uint8*)platform_map_file(TEXTURE_CACHE_PATH, size);
+    if (!data) return NULL;
+    
+    const TextureCacheHeader* header = (const TextureCacheHeader*)data;
+    const TextureCacheEntry* entries = (const TextureCacheEntry*)(data + sizeof(TextureCacheHeader));
+    bool valid = *size >= sizeof(TextureCacheHeader) + count * sizeof(TextureCacheEntry) &&
+                 header->magic == TEXTURE_CACHE_MAGIC && header->version == TEXTURE_CACHE_VERSION &&
+                 header->key == key && header->file_size == *size && header->entry_count == (Uint32)count;
+    for (int i = 0; valid && i < count; i++) {
+        const TextureCacheEntry* e = &entries[i];
+        valid = e->type == (Uint32)items[i].type && e->index == (Uint32)items[i].index &&
+                e->w > 0 && e->h > 0 && e->w <= 16384 && e->h <= 16384 && e->offset % 64 == 0 &&
+                e->offset <= *size && (Uint64)e->w * e->h * 4 <= *size - e->offset;
+    }
+    for (int i = 0; valid && i < count; i++) {
+        items[i].surface = SDL_CreateRGBSurfaceWithFormatFrom((void*)(data + entries[i].offset), entries[i].w,
+                                                              entries[i].h, 32, entries[i].w * 4,
+                                                              SDL_PIXELFORMAT_ARGB8888);
+        valid = items[i].surface != NULL;
+    }
+    if (!valid) {
+        for (int i = 0; i < count; i++) {
+            SDL_FreeSurface(items[i].surface);
+            items[i].surface = NULL;
+        }
+        platform_unmap_file(data, *size);
+        return NULL;
+    }
+    return data;
+}
+
+// 把生成的表面写入缓存：先写临时文件再替换，中途失败不会留下损坏的缓存
+static void save_texture_cache(const StartupSurface* items, int count, Uint64 key) {
+    TextureCacheHeader header = {TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION, key, 0, (Uint32)count, 0};
+    TextureCacheEntry* entries = calloc(count, sizeof(TextureCacheEntry));
+    if (!entries) return;
+    Uint64 offset = (sizeof(TextureCacheHeader) + count * sizeof(TextureCacheEntry) + 63) & ~(Uint64)63;
+    for (int i = 0; i < count; i++) {
+        const SDL_Surface* surface = items[i].surface;
+        if (!surface || surface->format->BytesPerPixel != 4) {
+            free(entries);  // 有表面生成失败，不写缓存
+            return;
+        }
+        entries[i].type = items[i].type;
+        entries[i].index = items[i].index;
+        entries[i].w = surface->w;
+        entries[i].h = surface->h;
+        entries[i].offset = offset;
+        offset = (offset + (Uint64)surface->w * surface->h * 4 + 63) & ~(Uint64)63;
+    }
+    header.file_size = offset;
+    
+    const char* temp_path = TEXTURE_CACHE_PATH ".tmp";
+    FILE* file = fopen(temp_path, "wb");
+    bool ok = file != NULL;
+    if (ok) {
+        static const Uint8 zeros[64] = {0};
+        Uint64 written = sizeof(header) + count * sizeof(TextureCacheEntry);
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(entries, sizeof(TextureCacheEntry), count, file) == (size_t)count;
+        for (int i = 0; ok && i < count; i++) {
+            const SDL_Surface* surface = items[i].surface;
+            ok = fwrite(zeros, 1, entries[i].offset - written, file) == entries[i].offset - written;
+            for (int y = 0; ok && y < surface->h; y++) {
+                ok = fwrite((const Uint8*)surface->pixels + y * surface->pitch, 4, surface->w, file) == (size_t)surface->w;
+            }
+            written = entries[i].offset + (Uint64)surface->w * surface->h * 4;
+        }
+        ok = fwrite(zeros, 1, header.file_size - written, file) == header.file_size - written && ok;
+        ok = fclose(file) == 0 && ok;
+    }
+    if (ok) ok = platform_replace_file(temp_path, TEXTURE_CACHE_PATH);
+    if (!ok) {
+        printf("警告：无法写入纹理缓存 %s\n", TEXTURE_CACHE_PATH);
+        remove(temp_path);
+    }
+    free(entries);
+}
+
+// 工作线程：生成 [begin, end) 的表面，只读场景参数，各自写入自己的表面
+static void generate_startup_surfaces(int begin, int end, int worker, void* userdata) {
+    (void)worker;
+    StartupSurface* items = (StartupSurface*)userdata;
+    for (int i = begin; i < end; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        switch (items[i].type) {
+            case STARTUP_MOON:
+                items[i].surface = generate_moon_surface();
+                break;
+            case STARTUP_CLOUD:
+                items[i].surface = generate_cloud_surface(items[i].index);
+                break;
+            case STARTUP_RIPPLE_ATLAS:
+                items[i].surface = generate_ripple_atlas_surface();
+                break;
+            case STARTUP_LIGHTNING_GLOW:
+                items[i].surface = generate_lightning_glow_surface();
+                break;
+            case STARTUP_MOUNTAIN:
+                items[i].surface = generate_mountain_surface(&mountains[items[i].index]);
+                break;
+            case STARTUP_LOTUS_PAD:
+                items[i].surface = generate_lotus_surface(&lotus_pads[items[i].index]);
+                break;
+            case STARTUP_LOTUS_FLOWER:
+                items[i].surface = generate_flower_surface(&lotus_flowers[items[i].index]);
+                break;
+        }
+        items[i].time = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+    }
+}
+
+// 主线程：把一张表面上传为纹理并设置混合方式，随后释放表面
+static void upload_startup_surface(StartupSurface* item) {
+    static const char* names[] = {"月亮", "云层", "涟漪图集", "闪电光晕", "山体", "荷叶", "荷花"};
+    if (!item->surface) return;
+    
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, item->surface);
+    if (!texture) {
+        printf("无法创建%s纹理! SDL错误: %s\n", names[item->type], SDL_GetError());
+    }
+    switch (item->type) {
+        case STARTUP_MOON:
+            moon_texture = texture;
+            break;
+        case STARTUP_CLOUD:
+            cloud_textures[item->index] = texture;
+            cloud_offsets[item->index] = 0;
+            break;
+        case STARTUP_RIPPLE_ATLAS:
+            ripple_atlas = texture;
+            if (texture) SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            // 平铺光栅化直接从内存中的图集取像素；缓存中的表面指向映射的文件，需要复制一份
+            if (soft_raster.active && (item->surface->flags & SDL_PREALLOC)) {
+                soft_raster.ripple_atlas = SDL_DuplicateSurface(item->surface);
+            } else if (soft_raster.active) {
+                soft_raster.ripple_atlas = item->surface;
+                item->surface = NULL;
+            }
+            break;
+        case STARTUP_LIGHTNING_GLOW:
+            lightning_glow = texture;
+            if (texture) SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            break;
+        case STARTUP_MOUNTAIN: {
+            Mountain* mountain = &mountains[item->index];
+            mountain->texture = texture;
+            if (texture) {
+                SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+                SDL_SetTextureColorMod(texture, mountain->color.r, mountain->color.g, mountain->color.b);
+            }
+            break;
+        }
+        case STARTUP_LOTUS_PAD:
+            lotus_pads[item->index].texture = texture;
+            break;
+        case STARTUP_LOTUS_FLOWER:
+            lotus_flowers[item->index].texture = texture;
+            break;
+    }
+    SDL_FreeSurface(item->surface);
+    item->surface = NULL;
+}
+
+// 初始化场景：参数、并行生成表面、上传纹理、背景层，各阶段计入 startup_timing
+bool initialize_scene() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    initialize_stars();
+    initialize_mountains();
+    initialize_reeds();
+    initialize_lotus_pads();
+    initialize_lotus_flowers();
+    layout_ripple_sprites();
+    startup_timing.scene_setup = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+    
+    // 登记要生成的表面，登记顺序即上传顺序
+    int capacity = 1 + MAX_CLOUD_LAYERS + 2 + MOUNTAIN_COUNT + lotus_pad_count + LOTUS_FLOWER_COUNT;
+    StartupSurface* items = calloc(capacity, sizeof(StartupSurface));
+    if (!items) {
+        printf("无法为启动纹理分配内存\n");
+        return false;
+    }
+    int count = 0;
+    items[count++] = (StartupSurface){.type = STARTUP_MOON, .index = 0};
+    for (int i = 0; i < MAX_CLOUD_LAYERS; i++) {
+        items[count++] = (StartupSurface){.type = STARTUP_CLOUD, .index = i};
+    }
+    items[count++] = (StartupSurface){.type = STARTUP_RIPPLE_ATLAS, .index = 0};
+    items[count++] = (StartupSurface){.type = STARTUP_LIGHTNING_GLOW, .index = 0};
+    for (int i = 0; i < MOUNTAIN_COUNT; i++) {
+        items[count++] = (StartupSurface){.type = STARTUP_MOUNTAIN, .index = i};
+    }
+    for (int i = 0; i < lotus_pad_count; i++) {
+        items[count++] = (StartupSurface){.type = STARTUP_LOTUS_PAD, .index = i};
+    }
+    for (int i = 0; i < LOTUS_FLOWER_COUNT; i++) {
+        items[count++] = (StartupSurface){.type = STARTUP_LOTUS_FLOWER, .index = i};
+    }
+    
+    startup_timing.surface_count = count;
+    
+    // 缓存命中时直接上传映射的像素，跳过全部生成
+    Uint64 key = texture_cache_key();
+    size_t cache_size = 0;
+    start = SDL_GetPerformanceCounter();
+    const void* cache = options.texture_cache ? load_texture_cache(items, count, key, &cache_size) : NULL;
+    startup_timing.cache_hit = cache != NULL;
+    startup_timing.cache_io = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+    
+    if (!cache) {
+        // 每张表面一个任务块：大小相差很大（云层比小荷叶大上百倍），由空闲线程窃取来平衡负载
+        start = SDL_GetPerformanceCounter();
+        parallel_for_coarse(count, 1, generate_startup_surfaces, items);
+        startup_timing.surface_gen = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+        for (int i = 0; i < count; i++) {
+            startup_timing.surface_cpu += items[i].time;
+        }
+        if (options.texture_cache) {
+            start = SDL_GetPerformanceCounter();
+            save_texture_cache(items, count, key);
+            startup_timing.cache_io += (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+        }
+    }
+    
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < count; i++) {
+        upload_startup_surface(&items[i]);
+    }
+    startup_timing.texture_upload = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+    free(items);
+    if (cache) {
+        platform_unmap_file(cache, cache_size);
+    }
+    
+    start = SDL_GetPerformanceCounter();
+    initialize_background_layers();
+    startup_timing.background = (SDL_GetPerformanceCounter() - start) * 1000.0 / perf.freq;
+    return true;
+}
+
+void print_startup_timing() {
+    const StartupTiming* t = &startup_timing;
+    printf("启动耗时 %.1fms\n", t->total);
+    printf("  SDL与线程池 %.1fms | 场景参数 %.1fms", t->sdl_init, t->scene_setup);
+    if (t->cache_hit) {
+        printf(" | 从缓存载入 %d 张表面 %.1fms", t->surface_count, t->cache_io);
+    } else {
+        printf(" | 生成 %d 张表面 %.1fms（%d 线程，累计 %.1fms）", t->surface_count, t->surface_gen,
+               worker_pool.thread_count + 1, t->surface_cpu);
+        if (options.texture_cache) printf(" | 写入缓存 %.1fms", t->cache_io);
+    }
+    printf(" | 上传纹理 %.1fms | 背景层 %.1fms", t->texture_upload, t->background);
+    if (options.audio) {
+        printf(" | 音频加载 %.1fms（主线程等待 %.1fms）", t->audio_decode, t->audio_wait);
+    }
+    printf("\n");
+}
+
+// 按缓存行对齐分配并清零；原始指针保存在对齐地址之前，由 cache_aligned_free 释放
+void* cache_aligned_alloc(size_t size) {
+    unsigned char* raw = calloc(1, size + CACHE_LINE_SIZE + sizeof(void*));
+    if (raw == NULL) return NULL;
+    uintptr_t aligned = ((uintptr_t)(raw + sizeof(void*)) + CACHE_LINE_SIZE - 1) & ~(uintptr_t)(CACHE_LINE_SIZE - 1);
+    ((void**)aligned)[-1] = raw;
+    return (void*)aligned;
+}
+
+void cache_aligned_free(void* ptr) {
+    if (ptr != NULL) {
+        free(((void**)ptr)[-1]);
+    }
+}
+
+// 雨滴的浮点数组按8个元素取整，SIMD尾部和批量随机数可以整组读写
+static float* alloc_float_array(int count) {
+    return cache_aligned_alloc(SIMD_ROUND_UP(count) * sizeof(float));
+}
+
+// 按启动参数分配粒子池和场景对象，并打印各池的内存占用
+bool allocate_pools() {
+    max_raindrops = options.max_raindrops;
+    max_ripples = options.max_ripples;
+    max_splashes = options.max_splashes;
+    stars_count = options.stars;
+    lotus_pad_count = options.lotus_pads;
+    
+    raindrops.x = alloc_float_array(max_raindrops);
+    raindrops.y = alloc_float_array(max_raindrops);
+    raindrops.z = alloc_float_array(max_raindrops);
+    raindrops.speed_x = alloc_float_array(max_raindrops);
+    raindrops.speed_y = alloc_float_array(max_raindrops);
+    raindrops.prev_x = alloc_float_array(max_raindrops);
+    raindrops.prev_y = alloc_float_array(max_raindrops);
+    raindrops.fall_mask = alloc_float_array(max_raindrops);
+    raindrops.color = cache_aligned_alloc(max_raindrops * sizeof(SDL_Color));
+    raindrops.size = cache_aligned_alloc(max_raindrops * sizeof(Uint8));
+    raindrops.in_water = cache_aligned_alloc(max_raindrops * sizeof(bool));
+    raindrops.creation_time = cache_aligned_alloc(max_raindrops * sizeof(Uint32));
+    raindrops.water_time = cache_aligned_alloc(max_raindrops * sizeof(Uint32));
+    rain_jitter = alloc_float_array(max_raindrops);
+    rain_spawn_random = alloc_float_array(max_raindrops);
+    ripples = cache_aligned_alloc(max_ripples * sizeof(Ripple));
+    splashes = cache_aligned_alloc(max_splashes * sizeof(Splash));
+    stars = cache_aligned_alloc(stars_count * sizeof(Star));
+    lotus_pads = cache_aligned_alloc(lotus_pad_count * sizeof(LotusPad));
+    
+    collision_grid.collider_capacity = lotus_pad_count + LOTUS_FLOWER_COUNT + REED_COUNT;
+    collision_grid.ref_capacity = collision_grid.collider_capacity * 16;
+    collision_grid.colliders = cache_aligned_alloc(collision_grid.collider_capacity * sizeof(Collider));
+    collision_grid.cell_items = cache_aligned_alloc(collision_grid.ref_capacity * sizeof(int));
+    collision_grid.cell_start = cache_aligned_alloc((COLLISION_GRID_CELLS + 1) * sizeof(int));
+    collision_grid.cell_fill = cache_aligned_alloc(COLLISION_GRID_CELLS * sizeof(int));
+    
+    if (!raindrops.x || !raindrops.y || !raindrops.z || !raindrops.speed_x || !raindrops.speed_y ||
+        !raindrops.prev_x || !raindrops.prev_y || !raindrops.fall_mask || !raindrops.color ||
+        !raindrops.size || !raindrops.in_water || !raindrops.creation_time || !raindrops.water_time ||
+        !rain_jitter || !rain_spawn_random || !ripples || !splashes || !stars || !lotus_pads ||
+        !collision_grid.colliders || !collision_grid.cell_items ||
+        !collision_grid.cell_start || !collision_grid.cell_fill) {
+        printf("无法分配粒子池内存! 雨滴 %d，涟漪 %d，水珠 %d\n", max_raindrops, max_ripples, max_splashes);
+        return false;
+    }
+    
+    double mb = 1024.0 * 1024.0;
+    printf("粒子池：雨滴 %d（%.1f MB），涟漪 %d（%.1f MB），水珠 %d（%.1f MB）\n",
+           max_raindrops, (double)max_raindrops * RAINDROP_BYTES / mb,
+           max_ripples, (double)max_ripples * sizeof(Ripple) / mb,
+           max_splashes, (double)max_splashes * sizeof(Splash) / mb);
+    return true;
+}
+
+void free_pools() {
+    cache_aligned_free(raindrops.x);
+    cache_aligned_free(raindrops.y);
+    cache_aligned_free(raindrops.z);
+    cache_aligned_free(raindrops.speed_x);
+    cache_aligned_free(raindrops.speed_y);
+    cache_aligned_free(raindrops.prev_x);
+    cache_aligned_free(raindrops.prev_y);
+    cache_aligned_free(raindrops.fall_mask);
+    cache_aligned_free(raindrops.color);
+    cache_aligned_free(raindrops.size);
+    cache_aligned_free(raindrops.in_water);
+    cache_aligned_free(raindrops.creation_time);
+    cache_aligned_free(raindrops.water_time);
+    cache_aligned_free(rain_jitter);
+    cache_aligned_free(rain_spawn_random);
+    cache_aligned_free(ripples);
+    cache_aligned_free(splashes);
+    cache_aligned_free(stars);
+    cache_aligned_free(lotus_pads);
+    cache_aligned_free(collision_grid.colliders);
+    cache_aligned_free(collision_grid.cell_items);
+    cache_aligned_free(collision_grid.cell_start);
+    cache_aligned_free(collision_grid.cell_fill);
+    memset(&raindrops, 0, sizeof(raindrops));
+    rain_jitter = NULL;
+    rain_spawn_random = NULL;
+    ripples = NULL;
+    splashes = NULL;
+    stars = NULL;
+    lotus_pads = NULL;
+    collision_grid.colliders = NULL;
+    collision_grid.cell_items = NULL;
+    collision_grid.cell_start = NULL;
+    collision_grid.cell_fill = NULL;
+    raindrop_count = ripple_count = splash_count = 0;
+}
+
+// 当前线程在池中的编号（主线程为0），不属于线程池时返回-1
+static int current_worker() {
+    if (!worker_pool.worker_tls) return -1;
+    return (int)(intptr_t)SDL_TLSGet(worker_pool.worker_tls) - 1;
+}
+
+// 压入当前线程自己的队列；队列已满时返回false，由调用者直接执行
+static bool push_job(int worker, const Job* job) {
+    WorkQueue* q = &worker_pool.queues[worker];
+    bool pushed = false;
+    
+    SDL_AtomicLock(&q->lock);
+    if (q->bottom - q->top < WORK_QUEUE_SIZE) {
+        q->jobs[q->bottom & (WORK_QUEUE_SIZE - 1)] = *job;
+        q->bottom++;
+        pushed = true;
+    }
+    SDL_AtomicUnlock(&q->lock);
+    
+    if (pushed) {
+        // 先登记工作数再检查休眠者：与 worker_thread_main 的顺序相反，避免丢失唤醒
+        SDL_AtomicIncRef(&worker_pool.queued_jobs);
+        if (SDL_AtomicGet(&worker_pool.sleeping) > 0) {
+            SDL_LockMutex(worker_pool.lock);
+            SDL_CondBroadcast(worker_pool.work_ready);
+            SDL_UnlockMutex(worker_pool.lock);
+        }
+    }
+    return pushed;
+}
+
+// 取一个工作单元：先从自己队列底部弹出，再依次从其他队列顶部窃取
+static bool take_job(int worker, Job* job) {
+    int queue_count = worker_pool.thread_count + 1;
+    
+    for (int n = 0; n < queue_count; n++) {
+        int victim = (worker + n) % queue_count;
+        WorkQueue* q = &worker_pool.queues[victim];
+        bool taken = false;
+        
+        SDL_AtomicLock(&q->lock);
+        if (q->bottom > q->top) {
+            if (victim == worker) {
+                q->bottom--;
+                *job = q->jobs[q->bottom & (WORK_QUEUE_SIZE - 1)];
+            } else {
+                *job = q->jobs[q->top & (WORK_QUEUE_SIZE - 1)];
+                q->top++;
+            }
+            taken = true;
+        }
+        SDL_AtomicUnlock(&q->lock);
+        
+        if (taken) {
+            SDL_AtomicAdd(&worker_pool.queued_jobs, -1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run_job(const Job* job, int worker) {
+    job->func(job->begin, job->end, worker, job->userdata);
+    // 计数器归零时唤醒在 help_until_done 中休眠的等待方（先递减再检查休眠者，与等待方顺序相反）
+    if (job->pending && SDL_AtomicAdd(job->pending, -1) == 1 && SDL_AtomicGet(&worker_pool.sleeping) > 0) {
+        SDL_LockMutex(worker_pool.lock);
+        SDL_CondBroadcast(worker_pool.work_ready);
+        SDL_UnlockMutex(worker_pool.lock);
+    }
+}
+
+// 等待计数器归零；等待期间帮忙执行队列中的工作，不会让线程闲置
+// 剩余工作都在其他线程手中时先让出几次时间片，仍未完成就休眠到有新工作或计数器归零
+static void help_until_done(SDL_atomic_t* pending, int worker) {
+    int idle_polls = 0;
+    while (SDL_AtomicGet(pending) > 0) {
+        Job job;
+        if (take_job(worker, &job)) {
+            run_job(&job, worker);
+            idle_polls = 0;
+        } else if (++idle_polls < 16) {
+            SDL_Delay(0);
+        } else {
+            SDL_LockMutex(worker_pool.lock);
+            SDL_AtomicIncRef(&worker_pool.sleeping);
+            while (SDL_AtomicGet(pending) > 0 && SDL_AtomicGet(&worker_pool.queued_jobs) == 0) {
+                SDL_CondWait(worker_pool.work_ready, worker_pool.lock);
+            }
+            SDL_AtomicAdd(&worker_pool.sleeping, -1);
+            SDL_UnlockMutex(worker_pool.lock);
+            idle_polls = 0;
+        }
+    }
+}
+
+static int SDLCALL worker_thread_main(void* data) {
+    int worker = (int)(intptr_t)data;
+    SDL_TLSSet(worker_pool.worker_tls, (void*)(intptr_t)(worker + 1), NULL);
+    
+    for (;;) {
+        Job job;
+        if (take_job(worker, &job)) {
+            run_job(&job, worker);
+            continue;
+        }
+        
+        // 所有队列都空了，休眠直到有新工作
+        SDL_LockMutex(worker_pool.lock);
+        SDL_AtomicIncRef(&worker_pool.sleeping);
+        while (!worker_pool.quit && SDL_AtomicGet(&worker_pool.queued_jobs) == 0) {
+            SDL_CondWait(worker_pool.work_ready, worker_pool.lock);
+        }
+        SDL_AtomicAdd(&worker_pool.sleeping, -1);
+        bool quit = worker_pool.quit;
+        SDL_UnlockMutex(worker_pool.lock);
+        if (quit) break;
+    }
+    return 0;
+}
+
+// 创建工作线程池，thread_count 为后台线程数（0表示全部在主线程执行）
+bool init_worker_pool(int thread_count) {
+    if (thread_count > MAX_WORKER_THREADS) thread_count = MAX_WORKER_THREADS;
+    if (thread_count < 0) thread_count = 0;
+    
+    worker_pool.worker_tls = SDL_TLSCreate();
+    worker_pool.lock = SDL_CreateMutex();
+    worker_pool.work_ready = SDL_CreateCond();
+    if (!worker_pool.worker_tls || !worker_pool.lock || !worker_pool.work_ready) {
+        printf("无法创建线程同步对象! SDL错误: %s\n", SDL_GetError());
+        return false;
+    }
+    // 主线程是0号线程
+    SDL_TLSSet(worker_pool.worker_tls, (void*)(intptr_t)1, NULL);
+    
+    // 线程数在创建线程前确定，工作线程窃取时会读取它
+    worker_pool.thread_count = thread_count;
+    for (int i = 0; i < thread_count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "physics-%d", i + 1);
+        worker_pool.threads[i] = SDL_CreateThread(worker_thread_main, name, (void*)(intptr_t)(i + 1));
+        if (!worker_pool.threads[i]) {
+            // 该线程的队列仍可被其他线程窃取，任务不会丢失
+            printf("警告：无法创建工作线程 %d! SDL错误: %s\n", i + 1, SDL_GetError());
+        }
+    }
+    return true;
+}
+
+void shutdown_worker_pool() {
+    if (!worker_pool.lock) return;
+    
+    SDL_LockMutex(worker_pool.lock);
+    worker_pool.quit = true;
+    SDL_CondBroadcast(worker_pool.work_ready);
+    SDL_UnlockMutex(worker_pool.lock);
+    for (int i = 0; i < worker_pool.thread_count; i++) {
+        if (worker_pool.threads[i]) SDL_WaitThread(worker_pool.threads[i], NULL);
+    }
+    worker_pool.thread_count = 0;
+    
+    SDL_DestroyCond(worker_pool.work_ready);
+    SDL_DestroyMutex(worker_pool.lock);
+    worker_pool.lock = NULL;
+    
+    for (int i = 0; i <= MAX_WORKER_THREADS; i++) {
+        free(worker_buffers[i].events);
+        free(worker_buffers[i].removals);
+        worker_buffers[i].events = NULL;
+        worker_buffers[i].removals = NULL;
+        worker_buffers[i].event_capacity = 0;
+        worker_buffers[i].removal_capacity = 0;
+    }
+}
+
+// 把 [0, count) 切成任务块压入 worker 的队列，帮忙执行直到全部完成
+static void run_chunks(int count, int chunk_size, ParallelForFunc func, void* userdata, int worker) {
+    SDL_atomic_t pending;
+    SDL_AtomicSet(&pending, (count + chunk_size - 1) / chunk_size);
+    for (int begin = 0; begin < count; begin += chunk_size) {
+        Job job;
+        job.func = func;
+        job.userdata = userdata;
+        job.begin = begin;
+        job.end = begin + chunk_size < count ? begin + chunk_size : count;
+        job.pending = &pending;
+        if (!push_job(worker, &job)) {
+            run_job(&job, worker);
+        }
+    }
+    help_until_done(&pending, worker);
+}
+
+// 分块并行执行 func，返回时所有任务块均已完成
+// 任务块压入调用线程的队列，由空闲线程窃取；元素较少或没有工作线程时直接执行
+void parallel_for(int count, int chunk_size, ParallelForFunc func, void* userdata) {
+    if (count <= 0) return;
+    int worker = current_worker();
+    if (worker < 0 || worker_pool.thread_count == 0 || count < PARALLEL_MIN_ITEMS) {
+        func(0, count, worker < 0 ? 0 : worker, userdata);
+        return;
+    }
+    run_chunks(count, chunk_size, func, userdata, worker);
+}
+
+// 与 parallel_for 相同，但不设最少元素数：用于每个元素开销都很大的循环（如光栅化分块）
+void parallel_for_coarse(int count, int chunk_size, ParallelForFunc func, void* userdata) {
+    if (count <= 0) return;
+    int worker = current_worker();
+    if (worker < 0 || worker_pool.thread_count == 0 || count <= chunk_size) {
+        func(0, count, worker < 0 ? 0 : worker, userdata);
+        return;
+    }
+    run_chunks(count, chunk_size, func, userdata, worker);
+}
+
+void init_task_graph(TaskGraph* graph) {
+    graph->task_count = 0;
+}
+
+// 添加任务，返回任务编号；前驱必须先于后继添加，因此编号顺序即拓扑顺序
+int add_task(TaskGraph* graph, const char* name, TaskFunc func) {
+    if (graph->task_count >= MAX_GRAPH_TASKS) {
+        printf("警告：任务图节点过多，忽略任务 %s\n", name);
+        return -1;
+    }
+    int id = graph->task_count++;
+    GraphTask* task = &graph->tasks[id];
+    task->name = name;
+    task->func = func;
+    task->graph = graph;
+    task->successor_count = 0;
+    task->dependency_count = 0;
+    task->start = 0;
+    task->end = 0;
+    task->nested = 0;
+    task->worker = 0;
+    return id;
+}
+
+// 声明 task 依赖 dependency 的结果
+void add_task_dependency(TaskGraph* graph, int task, int dependency) {
+    if (task < 0 || dependency < 0 || dependency >= task) return;
+    GraphTask* t = &graph->tasks[task];
+    GraphTask* d = &graph->tasks[dependency];
+    if (t->dependency_count >= MAX_TASK_LINKS || d->successor_count >= MAX_TASK_LINKS) {
+        printf("警告：任务 %s 的依赖过多\n", t->name);
+        return;
+    }
+    t->dependencies[t->dependency_count++] = dependency;
+    d->successors[d->successor_count++] = task;
+}
+
+static void run_graph_task(int begin, int end, int worker, void* userdata);
+
+static void schedule_graph_task(GraphTask* task, int worker) {
+    Job job;
+    job.func = run_graph_task;
+    job.userdata = task;
+    job.begin = 0;
+    job.end = 1;
+    job.pending = &task->graph->remaining;
+    if (!push_job(worker, &job)) {
+        run_job(&job, worker);
+    }
+}
+
+static void run_graph_task(int begin, int end, int worker, void* userdata) {
+    GraphTask* task = userdata;
+    (void)begin;
+    (void)end;
+    
+    // 在另一个任务的并行循环等待中执行时，把本任务的耗时记到外层任务的 nested 上
+    GraphTask* outer = task->graph->running[worker];
+    task->graph->running[worker] = task;
+    task->worker = worker;
+    task->nested = 0;
+    task->start = SDL_GetPerformanceCounter();
+    task->func(task->graph->ft);
+    task->end = SDL_GetPerformanceCounter();
+    task->graph->running[worker] = outer;
+    if (outer) {
+        outer->nested += task->end - task->start;
+    }
+    
+    // 最后一个完成的前驱负责把后继放入队列
+    for (int i = 0; i < task->successor_count; i++) {
+        GraphTask* next = &task->graph->tasks[task->successors[i]];
+        if (SDL_AtomicDecRef(&next->unfinished)) {
+            schedule_graph_task(next, worker);
+        }
+    }
+}
+
+// 执行整张任务图，返回时所有任务均已完成
+void run_task_graph(TaskGraph* graph, const FrameTime* ft) {
+    int worker = current_worker();
+    if (worker < 0) worker = 0;
+    
+    graph->ft = ft;
+    SDL_AtomicSet(&graph->remaining, graph->task_count);
+    for (int i = 0; i < graph->task_count; i++) {
+        SDL_AtomicSet(&graph->tasks[i].unfinished, graph->tasks[i].dependency_count);
+    }
+    // 倒序压入无前驱的任务，使本线程按添加顺序弹出执行
+    for (int i = graph->task_count - 1; i >= 0; i--) {
+        if (graph->tasks[i].dependency_count == 0) {
+            schedule_graph_task(&graph->tasks[i], worker);
+        }
+    }
+    help_until_done(&graph->remaining, worker);
+}
+
+// 任务耗时（毫秒），不含嵌套执行的其他任务
+double task_time_ms(const GraphTask* task) {
+    return (task->end - task->start - task->nested) * 1000.0 / perf.freq;
+}
+
+// 关键路径：沿依赖边累加耗时的最长链，即无限线程下本次执行的最短耗时
+double task_graph_critical_path(const TaskGraph* graph) {
+    double finish[MAX_GRAPH_TASKS];
+    double longest = 0.0;
+    
+    for (int i = 0; i < graph->task_count; i++) {
+        const GraphTask* task = &graph->tasks[i];
+        double ready = 0.0;
+        for (int d = 0; d < task->dependency_count; d++) {
+            if (finish[task->dependencies[d]] > ready) ready = finish[task->dependencies[d]];
+        }
+        finish[i] = ready + task_time_ms(task);
+        if (finish[i] > longest) longest = finish[i];
+    }
+    return longest;
+}
+
+static void clear_worker_buffers() {
+    for (int i = 0; i <= worker_pool.thread_count; i++) {
+        worker_buffers[i].event_count = 0;
+        worker_buffers[i].removal_count = 0;
+        worker_buffers[i].dropped_events = 0;
+        worker_buffers[i].dropped_removals = 0;
+    }
+}
+
+static void push_spawn_event(WorkerBuffer* buf, int source, SpawnType type,
+                             float x, float y, float z, SDL_Color color) {
+    if (buf->event_count == buf->event_capacity) {
+        int capacity = buf->event_capacity ? buf->event_capacity * 2 : 256;
+        SpawnEvent* events = realloc(buf->events, capacity * sizeof(SpawnEvent));
+        if (!events) {
+            buf->dropped_events++;
+            return;
+        }
+        buf->events = events;
+        buf->event_capacity = capacity;
+    }
+    SpawnEvent* ev = &buf->events[buf->event_count++];
+    ev->source = source;
+    ev->type = type;
+    ev->x = x;
+    ev->y = y;
+    ev->z = z;
+    ev->color = color;
+}
+
+static void push_removal(WorkerBuffer* buf, int index) {
+    if (buf->removal_count == buf->removal_capacity) {
+        int capacity = buf->removal_capacity ? buf->removal_capacity * 2 : 256;
+        int* removals = realloc(buf->removals, capacity * sizeof(int));
+        if (!removals) {
+            buf->dropped_removals++;
+            return;
+        }
+        buf->removals = removals;
+        buf->removal_capacity = capacity;
+    }
+    buf->removals[buf->removal_count++] = index;
+}
+
+static int compare_spawn_source(const void* a, const void* b) {
+    int sa = ((const SpawnEvent*)a)->source;
+    int sb = ((const SpawnEvent*)b)->source;
+    return (sa > sb) - (sa < sb);
+}
+
+static int compare_index_desc(const void* a, const void* b) {
+    int ia = *(const int*)a;
+    int ib = *(const int*)b;
+    return (ia < ib) - (ia > ib);
+}
+
+// 合并各线程的生成缓冲区：先按下标从大到小回收粒子（保证交换删除时末尾元素仍存活），
+// 再按来源粒子下标顺序创建新粒子，结果与线程数和任务调度顺序无关
+// 扩容失败时只处理放得下的部分，丢弃的数量（含各线程缓冲区丢弃的）打印警告
+static void merge_worker_buffers(void (*remove_func)(int), Uint32 current_time) {
+    static SpawnEvent* events = NULL;
+    static int* removals = NULL;
+    static int events_capacity = 0;
+    static int removals_capacity = 0;
+    
+    int event_total = 0;
+    int removal_total = 0;
+    int dropped_events = 0;
+    int dropped_removals = 0;
+    for (int i = 0; i <= worker_pool.thread_count; i++) {
+        event_total += worker_buffers[i].event_count;
+        removal_total += worker_buffers[i].removal_count;
+        dropped_events += worker_buffers[i].dropped_events;
+        dropped_removals += worker_buffers[i].dropped_removals;
+    }
+    if (event_total > events_capacity) {
+        SpawnEvent* grown = realloc(events, event_total * sizeof(SpawnEvent));
+        if (grown) {
+            events = grown;
+            events_capacity = event_total;
+        }
+    }
+    if (removal_total > removals_capacity) {
+        int* grown = realloc(removals, removal_total * sizeof(int));
+        if (grown) {
+            removals = grown;
+            removals_capacity = removal_total;
+        }
+    }
+    
+    event_total = 0;
+    removal_total = 0;
+    for (int i = 0; i <= worker_pool.thread_count; i++) {
+        WorkerBuffer* buf = &worker_buffers[i];
+        int n = buf->event_count < events_capacity - event_total ? buf->event_count : events_capacity - event_total;
+        if (n > 0) {
+            memcpy(events + event_total, buf->events, n * sizeof(SpawnEvent));
+            event_total += n;
+        }
+        dropped_events += buf->event_count - n;
+        n = buf->removal_count < removals_capacity - removal_total ? buf->removal_count : removals_capacity - removal_total;
+        if (n > 0) {
+            memcpy(removals + removal_total, buf->removals, n * sizeof(int));
+            removal_total += n;
+        }
+        dropped_removals += buf->removal_count - n;
+    }
+    if (dropped_events > 0 || dropped_removals > 0) {
+        printf("警告：生成缓冲区扩容失败，本步丢弃 %d 个新粒子、%d 次粒子回收\n", dropped_events, dropped_removals);
+    }
+    
+    if (removal_total > 1) {
+        qsort(removals, removal_total, sizeof(int), compare_index_desc);
+    }
+    for (int i = 0; i < removal_total; i++) {
+        remove_func(removals[i]);
+    }
+    
+    if (event_total > 1) {
+        qsort(events, event_total, sizeof(SpawnEvent), compare_spawn_source);
+    }
+    for (int i = 0; i < event_total; i++) {
+        SpawnEvent* ev = &events[i];
+        if (ev->type == SPAWN_RIPPLE) {
+            create_ripple(ev->x, ev->y, ev->z, ev->color, current_time);
+        } else {
+            create_splash(ev->x, ev->y, ev->z, ev->color, current_time);
+        }
+    }
+}
+
+static int isqrt(int v) {
+    int r = (int)sqrtf((float)v);
+    while (r * r > v) r--;
+    while ((r + 1) * (r + 1) <= v) r++;
+    return r;
+}
+
+// 用 color 填充一行中 [x0, x1] 的像素，SIMD路径每次写入8/4个像素
+static void fill_span(Uint32* row, int x0, int x1, Uint32 color) {
+    int x = x0;
+#ifdef SIMD_AVX2
+    __m256i c8 = _mm256_set1_epi32((int)color);
+    for (; x + 8 <= x1 + 1; x += 8) {
+        _mm256_storeu_si256((__m256i*)(row + x), c8);
+    }
+#endif
+#ifdef SIMD_SSE2
+    __m128i c4 = _mm_set1_epi32((int)color);
+    for (; x + 4 <= x1 + 1; x += 4) {
+        _mm_storeu_si128((__m128i*)(row + x), c4);
+    }
+#endif
+    for (; x <= x1; x++) {
+        row[x] = color;
+    }
+}
+
+// 实心圆：x*x + y*y <= r*r 的像素，逐行求出区间后整段写入，超出表面的部分被裁掉
+void fill_disc(SDL_Surface* surface, int cx, int cy, int radius, Uint32 color) {
+    for (int y = -radius; y <= radius; y++) {
+        int py = cy + y;
+        if (py < 0 || py >= surface->h) continue;
+        int half = isqrt(radius * radius - y * y);
+        int x0 = cx - half < 0 ? 0 : cx - half;
+        int x1 = cx + half >= surface->w ? surface->w - 1 : cx + half;
+        if (x0 <= x1) {
+            fill_span((Uint32*)surface->pixels + py * surface->pitch / 4, x0, x1, color);
+        }
+    }
+}
+
+// 批量生成 n 个雨滴，依次填入池末尾连续的空闲槽位，返回实际生成的数量
+// 深度、落点和速度的随机数由批量生成器整列填充，天气和风力相关的系数每批只计算一次
+int create_raindrops(int n, Uint32 current_time) {
+    // 雨滴池放不下的部分直接放弃
+    if (n > max_raindrops - raindrop_count) n = max_raindrops - raindrop_count;
+    if (n <= 0) return 0;
+    int start = raindrop_count;
+    int end = start + n;
+    raindrop_count = end;
+    
+    // 随机深度 (0-1)
+    rng_fill_floats(&rain_spawn_rng, rain_spawn_random, n, 0.0f, 1.0f);
+    memcpy(raindrops.z + start, rain_spawn_random, n * sizeof(float));
+    
+    // 根据深度，远处雨滴位置范围更大，模拟宽视场
+    rng_fill_floats(&rain_spawn_rng, rain_spawn_random, n, 0.0f, 1.0f);
+    for (int i = start; i < end; i++) {
+        float z_width_scale = 1.0f + (1.0f - raindrops.z[i]) * 2.0f;
+        raindrops.x[i] = rain_spawn_random[i - start] * window_width * z_width_scale -
+                         (z_width_scale - 1.0f) * window_width / 2;
+    }
+    
+    // 远处的雨滴看起来应该下落得更慢，并根据天气强度调整下落速度
+    float intensity_factor = 1.0f + (weather_intensity / 100.0f);
+    float wind_speed = wind_strength * 50.0f * intensity_factor;
+    rng_fill_floats(&rain_spawn_rng, rain_spawn_random, n, RAINDROP_FALL_SPEED_MIN, RAINDROP_FALL_SPEED_MAX);
+    for (int i = start; i < end; i++) {
+        float z_speed_scale = 0.2f + raindrops.z[i] * 0.8f;
+        raindrops.speed_y[i] = rain_spawn_random[i - start] * z_speed_scale * intensity_factor;
+        // 初始水平速度受风影响
+        raindrops.speed_x[i] = wind_speed * z_speed_scale;
+        raindrops.size[i] = 2 + rng_int(&spawn_rng, 5);  // 基础大小在2到6之间
+        raindrops.creation_time[i] = current_time;
+    }
+    
+    for (int i = start; i < end; i++) {
+        // 颜色需在创建涟漪之前确定
+        raindrops.color[i] = get_random_color();
+        
+        // 根据rain_surface_ratio决定雨滴是直接落在水面还是从天空落下
+        if (rng_float(&spawn_rng) < rain_surface_ratio) {
+            // 直接在水面随机位置生成雨滴
+            raindrops.y[i] = pond_height + rng_int(&spawn_rng, window_height - pond_height);
+            raindrops.in_water[i] = true;
+            raindrops.fall_mask[i] = 0.0f;
+            raindrops.water_time[i] = current_time;
+            
+            // 创建涟漪
+            create_ripple(raindrops.x[i], raindrops.y[i], raindrops.z[i], raindrops.color[i], current_time);
+        } else {
+            // 在天空生成雨滴
+            raindrops.in_water[i] = false;
+            raindrops.fall_mask[i] = 1.0f;
+            raindrops.y[i] = -10 - rng_int(&spawn_rng, 50);  // 从窗口上方不同高度开始
+        }
+        raindrops.prev_x[i] = raindrops.x[i];
+        raindrops.prev_y[i] = raindrops.y[i];
+    }
+    return n;
+}
+
+// 回收雨滴：用末尾的存活雨滴填补空位，保持数组紧密
+void remove_raindrop(int index) {
+    int last = --raindrop_count;
+    if (index == last) return;
+    
+    raindrops.x[index] = raindrops.x[last];
+    raindrops.y[index] = raindrops.y[last];
+    raindrops.z[index] = raindrops.z[last];
+    raindrops.speed_x[index] = raindrops.speed_x[last];
+    raindrops.speed_y[index] = raindrops.speed_y[last];
+    raindrops.prev_x[index] = raindrops.prev_x[last];
+    raindrops.prev_y[index] = raindrops.prev_y[last];
+    raindrops.fall_mask[index] = raindrops.fall_mask[last];
+    raindrops.color[index] = raindrops.color[last];
+    raindrops.size[index] = raindrops.size[last];
+    raindrops.in_water[index] = raindrops.in_water[last];
+    raindrops.creation_time[index] = raindrops.creation_time[last];
+    raindrops.water_time[index] = raindrops.water_time[last];
+}
+
+void create_ripple(float x, float y, float z, SDL_Color color, Uint32 current_time) {
+    // 画质调节器降低画质时按比例保留涟漪（均匀间隔，不消耗随机数），落水声照常记录
+    quality.ripple_debt += current_quality()->ripples;
+    if (quality.ripple_debt < 1.0f) {
+        queue_splash_sound(x, z);
+        return;
+    }
+    quality.ripple_debt -= 1.0f;
+    
+    // 涟漪池已满则放弃；否则直接取末尾的空闲槽位
+    if (ripple_count >= max_ripples) return;
+    Ripple* ripple = &ripples[ripple_count++];
+    
+    ripple->x = x;
+    ripple->y = y;
+    ripple->z = z;
+    ripple->radius = 0;
+    // 远处的涟漪最大半径应该更小
+    float z_radius_scale = get_z_scale(z);
+    ripple->max_radius = (20 + rng_int(&particle_rng, 40)) * z_radius_scale;
+    ripple->color = color;
+    ripple->creation_time = current_time;
+
+    // 记录落水声，本帧结束时合并播放
+    queue_splash_sound(x, z);
+}
+
+// 记录一次落水，只累加计数、响度和水平分布，不直接调用混音器
+void queue_splash_sound(float x, float z) {
+    float loudness = get_z_scale(z);
+    int bin = (int)(project_x(x, z) * RAIN_SYNTH_PAN_BINS / window_width);
+    if (bin < 0) bin = 0;
+    if (bin >= RAIN_SYNTH_PAN_BINS) bin = RAIN_SYNTH_PAN_BINS - 1;
+    audio_voices.impacts++;
+    audio_voices.loudness += loudness;
+    audio_voices.pan[bin] += loudness;
+}
+
+// 记录一次闪电，雷声在本帧结束时播放一次
+void queue_thunder_sound() {
+    audio_voices.thunder_pending = true;
+}
+
+// 每帧调用一次：播放雷声，并把本帧的落水统计换算成雨声合成参数
+// sim_seconds 为本帧推进的模拟时间，为0时继续累计到下一帧
+void flush_audio_voices(float sim_seconds) {
+    AudioVoices* av = &audio_voices;
+    
+    // 第一次进入大雨（之后可能出现闪电）时载入雷声
+    if (!thunder.loaded && current_weather >= WEATHER_HEAVY_RAIN) {
+        load_thunder_sound();
+    }
+    if (av->thunder_pending && load_thunder_sound()) {
+        // 由音频线程在下一个混音缓冲区开始播放
+        SDL_AtomicLock(&thunder.lock);
+        thunder.pending_starts++;
+        SDL_AtomicUnlock(&thunder.lock);
+    }
+    av->thunder_pending = false;
+    if (thunder.loaded) {
+        prefetch_thunder_chunks(&thunder);
+    }
+    if (sim_seconds <= 0.0f) return;
+    
+    if (rain_synth.enabled) {
+        RainSynthParams params = {0};
+        params.rate = av->impacts / sim_seconds;
+        if (av->impacts > 0) {
+            params.loudness = av->loudness / av->impacts;
+            for (int i = 0; i < RAIN_SYNTH_PAN_BINS; i++) {
+                params.pan[i] = av->pan[i] / av->loudness;
+            }
+        }
+        SDL_AtomicLock(&rain_synth.lock);
+        rain_synth.target = params;
+        SDL_AtomicUnlock(&rain_synth.lock);
+    }
+    
+    av->impacts_total += av->impacts;
+    av->impacts = 0;
+    av->loudness = 0.0f;
+    memset(av->pan, 0, sizeof(av->pan));
+}
+
+// 打开WAV文件并解析格式，只读取文件头；无法打开或格式不支持时返回false
+bool open_sound_stream(SoundStream* stream, const char* path) {
+    memset(stream, 0, sizeof(*stream));
+    SDL_RWops* file = SDL_RWFromFile(path, "rb");
+    if (!file) {
+        printf("无法打开音频文件 %s! SDL错误: %s\n", path, SDL_GetError());
+        return false;
+    }
+    
+    // 依次查找 fmt、fact 和 data 块
+    Sint64 file_size = SDL_RWsize(file);
+    Uint32 data_size = 0, fact_frames = 0;
+    int bits = 0;
+    bool have_fmt = false, have_data = false;
+    bool ok = SDL_ReadLE32(file) == 0x46464952;   // "RIFF"
+    SDL_ReadLE32(file);
+    ok = ok && SDL_ReadLE32(file) == 0x45564157;  // "WAVE"
+    while (ok && !have_data && SDL_RWtell(file) + 8 <= file_size) {
+        Uint32 id = SDL_ReadLE32(file);
+        Uint32 size = SDL_ReadLE32(file);
+        Sint64 next = SDL_RWtell(file) + size + (size & 1);
+        if (id == 0x20746D66 && size >= 16) {            // "fmt "
+            stream->format = SDL_ReadLE16(file);
+            stream->channels = SDL_ReadLE16(file);
+            stream->sample_rate = (int)SDL_ReadLE32(file);
+            SDL_ReadLE32(file);                          // 每秒字节数
+            stream->block_align = SDL_ReadLE16(file);
+            bits = SDL_ReadLE16(file);
+            have_fmt = true;
+        } else if (id == 0x74636166 && size >= 4) {     // "fact"：ADPCM的总帧数
+            fact_frames = SDL_ReadLE32(file);
+        } else if (id == 0x61746164) {                  // "data"
+            stream->data_offset = SDL_RWtell(file);
+            data_size = (Sint64)size < file_size - stream->data_offset ? size : (Uint32)(file_size - stream->data_offset);
+            have_data = true;
+        }
+        if (!have_data && SDL_RWseek(file, next, RW_SEEK_SET) < 0) ok = false;
+    }
+    ok = ok && have_fmt && have_data && stream->channels >= 1 && stream->channels <= 2 && stream->sample_rate > 0;
+    
+    if (ok && stream->format == 1 && bits == 16 && stream->block_align == stream->channels * 2) {
+        stream->total_frames = data_size / stream->block_align;
+        stream->chunk_frames = THUNDER_CHUNK_FRAMES;
+        stream->chunk_bytes = THUNDER_CHUNK_FRAMES * stream->block_align;
+    } else if (ok && stream->format == 0x11 && bits == 4 && stream->block_align > 4 * stream->channels) {
+        // IMA ADPCM：每块先是各声道4字节的块头（含第一帧），之后每帧每声道4位；不完整的末尾块忽略
+        stream->block_frames = (stream->block_align - 4 * stream->channels) * 2 / stream->channels + 1;
+        int blocks = data_size / stream->block_align;
+        stream->total_frames = blocks * stream->block_frames;
+        if (fact_frames > 0 && (int)fact_frames < stream->total_frames) stream->total_frames = (int)fact_frames;
+        int blocks_per_chunk = THUNDER_CHUNK_FRAMES / stream->block_frames;
+        if (blocks_per_chunk < 1) blocks_per_chunk = 1;
+        stream->chunk_frames = blocks_per_chunk * stream->block_frames;
+        stream->chunk_bytes = blocks_per_chunk * stream->block_align;
+    } else {
+        ok = false;
+    }
+    if (!ok || stream->total_frames <= 0) {
+        printf("不支持的音频文件 %s（需要16位PCM或IMA ADPCM编码的WAV，单声道或立体声）\n", path);
+        SDL_RWclose(file);
+        return false;
+    }
+    stream->file = file;
+    return true;
+}
+
+void close_sound_stream(SoundStream* stream) {
+    if (stream->file) SDL_RWclose(stream->file);
+    free(stream->raw);
+    memset(stream, 0, sizeof(*stream));
+}
+
+// IMA ADPCM 解码表
+static const int ima_index_table[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+static const int ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66,
+    73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449,
+    494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272,
+    2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493,
+    10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static int ima_decode_nibble(int nibble, int* predictor, int* index) {
+    int step = ima_step_table[*index];
+    int diff = step >> 3;
+    if (nibble & 1) diff += step >> 2;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 4) diff += step;
+    *predictor += (nibble & 8) ? -diff : diff;
+    if (*predictor > 32767) *predictor = 32767;
+    if (*predictor < -32768) *predictor = -32768;
+    *index += ima_index_table[nibble];
+    if (*index < 0) *index = 0;
+    if (*index > 88) *index = 88;
+    return *predictor;
+}
+
+// 解码一个ADPCM块的前 frames 帧，输出交错的立体声
+static void decode_ima_block(const Uint8* block, int channels, int frames, Sint16* out) {
+    int predictor[2], index[2];
+    for (int c = 0; c < channels; c++) {
+        predictor[c] = (Sint16)(block[c * 4] | (block[c * 4 + 1] << 8));
+        index[c] = block[c * 4 + 2] > 88 ? 88 : block[c * 4 + 2];
+        out[c] = (Sint16)predictor[c];
+    }
+    // 之后各声道轮流4个字节（8帧），低4位在前
+    const Uint8* data = block + 4 * channels;
+    for (int f = 1; f < frames; f += 8) {
+        for (int c = 0; c < channels; c++) {
+            for (int k = 0; k < 8; k++) {
+                int v = ima_decode_nibble((data[k >> 1] >> ((k & 1) * 4)) & 15, &predictor[c], &index[c]);
+                if (f + k < frames) out[(f + k) * 2 + c] = (Sint16)v;
+            }
+            data += 4;
+        }
+    }
+    if (channels == 1) {
+        for (int f = 0; f < frames; f++) out[f * 2 + 1] = out[f * 2];
+    }
+}
+
+// 读取并解码第 chunk 块，输出交错的立体声；返回帧数，读文件失败时返回0
+static int decode_sound_chunk(SoundStream* stream, int chunk, Sint16* out) {
+    int first = chunk * stream->chunk_frames;
+    int frames = stream->total_frames - first;
+    if (frames > stream->chunk_frames) frames = stream->chunk_frames;
+    if (frames <= 0) return 0;
+    
+    size_t bytes = stream->format == 1 ? (size_t)frames * stream->block_align
+                 : (size_t)((frames + stream->block_frames - 1) / stream->block_frames) * stream->block_align;
+    if (SDL_RWseek(stream->file, stream->data_offset + (Sint64)chunk * stream->chunk_bytes, RW_SEEK_SET) < 0 ||
+        SDL_RWread(stream->file, stream->raw, 1, bytes) != bytes) {
+        return 0;
+    }
+    if (stream->format == 1) {
+        const Uint8* src = stream->raw;
+        for (int f = 0; f < frames; f++) {
+            Sint16 l = (Sint16)(src[0] | (src[1] << 8));
+            Sint16 r = stream->channels == 2 ? (Sint16)(src[2] | (src[3] << 8)) : l;
+            out[f * 2] = l;
+            out[f * 2 + 1] = r;
+            src += stream->block_align;
+        }
+    } else {
+        for (int f = 0; f < frames; f += stream->block_frames) {
+            int n = frames - f < stream->block_frames ? frames - f : stream->block_frames;
+            decode_ima_block(stream->raw + f / stream->block_frames * stream->block_align, stream->channels, n, out + f * 2);
+        }
+    }
+    return frames;
+}
+
+// 分配解码缓存并解码第一块（常驻缓存，新的雷声可以立即开始）；之后的块由 prefetch_thunder_chunks 解码
+// 无法分配或读取时关闭雷声，不再重试
+bool load_thunder_sound() {
+    if (thunder.loaded) return true;
+    if (!thunder.stream.file || !rain_synth.enabled) return false;
+    
+    SoundStream* stream = &thunder.stream;
+    Sint16* samples = malloc(sizeof(Sint16) * 2 * stream->chunk_frames * THUNDER_CACHE_CHUNKS);
+    stream->raw = malloc(stream->chunk_bytes);
+    if (!samples || !stream->raw) {
+        printf("无法为雷声解码缓存分配内存，雷声已禁用\n");
+        free(samples);
+        close_sound_stream(stream);
+        return false;
+    }
+    for (int i = 0; i < THUNDER_CACHE_CHUNKS; i++) {
+        thunder.cache[i].chunk = -1;
+        thunder.cache[i].frames = 0;
+        thunder.cache[i].last_use = 0;
+        thunder.cache[i].samples = samples + i * 2 * stream->chunk_frames;
+    }
+    thunder.cache[0].frames = decode_sound_chunk(stream, 0, thunder.cache[0].samples);
+    if (thunder.cache[0].frames == 0) {
+        printf("无法读取雷声音频，雷声已禁用\n");
+        free(samples);
+        thunder.cache[0].samples = NULL;
+        close_sound_stream(stream);
+        return false;
+    }
+    thunder.cache[0].chunk = 0;
+    thunder.cache[0].last_use = thunder.use_clock = 1;
+    thunder.step = ((Uint64)stream->sample_rate << 16) / rain_synth.sample_rate;
+    
+    SDL_AtomicLock(&thunder.lock);
+    thunder.loaded = true;
+    SDL_AtomicUnlock(&thunder.lock);
+    printf("雷声：%s，%d Hz，%.1f秒，解码缓存 %d KB（完整解码需 %d KB）\n",
+           stream->format == 1 ? "PCM" : "IMA ADPCM", stream->sample_rate,
+           (double)stream->total_frames / stream->sample_rate,
+           (int)(sizeof(Sint16) * 2 * stream->chunk_frames * THUNDER_CACHE_CHUNKS / 1024),
+           (int)(sizeof(Sint16) * 2 * (Sint64)stream->total_frames / 1024));
+    return true;
+}
+
+// 须在音频回调停止后调用
+void free_thunder_sound() {
+    if (thunder.loaded) {
+        printf("雷声：解码 %d 块，缓存命中 %d 次\n", thunder.decoded_chunks, thunder.cache_hits);
+    }
+    free(thunder.cache[0].samples);
+    for (int i = 0; i < THUNDER_CACHE_CHUNKS; i++) {
+        thunder.cache[i].samples = NULL;
+    }
+    close_sound_stream(&thunder.stream);
+    thunder.loaded = false;
+}
+
+// 主线程：为正在播放的雷声解码当前块和之后 THUNDER_PREFETCH_CHUNKS 块，替换不再需要的最久未用项
+// 读文件时不持有锁；被替换的项先标记为空，音频线程不会读到解码了一半的样本
+void prefetch_thunder_chunks(ThunderPlayer* player) {
+    int needed[MAX_THUNDER_VOICES * (THUNDER_PREFETCH_CHUNKS + 1) + 1];
+    int count = 0;
+    needed[count++] = 0;
+    SDL_AtomicLock(&player->lock);
+    for (int v = 0; v < MAX_THUNDER_VOICES; v++) {
+        if (!player->voices[v].active) continue;
+        int chunk = (int)(player->voices[v].position >> 16) / player->stream.chunk_frames;
+        for (int k = 0; k <= THUNDER_PREFETCH_CHUNKS; k++) {
+            needed[count++] = chunk + k;
+        }
+    }
+    SDL_AtomicUnlock(&player->lock);
+    
+    for (int n = 0; n < count; n++) {
+        int chunk = needed[n];
+        if (chunk * player->stream.chunk_frames >= player->stream.total_frames) continue;
+        SoundCacheEntry* victim = NULL;
+        bool cached = false;
+        SDL_AtomicLock(&player->lock);
+        for (int i = 0; i < THUNDER_CACHE_CHUNKS && !cached; i++) {
+            SoundCacheEntry* entry = &player->cache[i];
+            cached = entry->chunk == chunk;
+            bool in_use = false;
+            for (int k = 0; k < count && !in_use; k++) {
+                in_use = entry->chunk == needed[k];
+            }
+            if (!in_use && (victim == NULL || entry->last_use < victim->last_use)) victim = entry;
+        }
+        if (!cached && victim) {
+            victim->chunk = -1;
+            victim->frames = 0;
+        }
+        SDL_AtomicUnlock(&player->lock);
+        if (cached || !victim) continue;
+        
+        // 读文件失败时仍记下这一块（0帧），音频线程据此停止声部
+        int frames = decode_sound_chunk(&player->stream, chunk, victim->samples);
+        SDL_AtomicLock(&player->lock);
+        victim->chunk = chunk;
+        victim->frames = frames;
+        victim->last_use = ++player->use_clock;
+        SDL_AtomicUnlock(&player->lock);
+        player->decoded_chunks++;
+    }
+}
+
+// 音频线程（持有锁）：在缓存中查找第 chunk 块，不读文件；主线程尚未解码时返回 NULL
+static SoundCacheEntry* thunder_chunk(ThunderPlayer* player, int chunk) {
+    for (int i = 0; i < THUNDER_CACHE_CHUNKS; i++) {
+        SoundCacheEntry* entry = &player->cache[i];
+        if (entry->chunk == chunk) {
+            entry->last_use = ++player->use_clock;
+            player->cache_hits++;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// 音频线程：开始新请求的雷声，把正在播放的雷声叠加到 mix（交错立体声）上
+// 只做内存中的混音，整个过程持有锁，主线程替换缓存项时不会与之交错
+static void thunder_render(ThunderPlayer* player, float* mix, int frames) {
+    SDL_AtomicLock(&player->lock);
+    int starts = player->pending_starts;
+    player->pending_starts = 0;
+    if (!player->loaded) {
+        SDL_AtomicUnlock(&player->lock);
+        return;
+    }
+    
+    // 没有空闲的声部时，从头重新开始播放最久的那一个
+    for (; starts > 0; starts--) {
+        ThunderVoice* voice = &player->voices[0];
+        for (int v = 0; v < MAX_THUNDER_VOICES && voice->active; v++) {
+            if (!player->voices[v].active || player->voices[v].position > voice->position) {
+                voice = &player->voices[v];
+            }
+        }
+        voice->active = true;
+        voice->position = 0;
+    }
+    
+    for (int v = 0; v < MAX_THUNDER_VOICES; v++) {
+        ThunderVoice* voice = &player->voices[v];
+        int i = 0;
+        while (voice->active && i < frames) {
+            int frame = (int)(voice->position >> 16);
+            if (frame >= player->stream.total_frames) {
+                voice->active = false;
+                break;
+            }
+            int chunk = frame / player->stream.chunk_frames;
+            int chunk_first = chunk * player->stream.chunk_frames;
+            // 主线程还没解码到这一块时保持位置，下一个缓冲区再继续（这段时间输出静音）
+            SoundCacheEntry* entry = thunder_chunk(player, chunk);
+            if (entry == NULL) break;
+            // 在这一块内尽量多地输出；读文件失败（没有进展）时停止这个声部
+            const Sint16* src = entry->samples;
+            int start = i;
+            for (; i < frames; i++) {
+                int f = (int)(voice->position >> 16) - chunk_first;
+                if (f >= entry->frames) break;
+                mix[i * 2] += src[f * 2] * (1.0f / 32768.0f);
+                mix[i * 2 + 1] += src[f * 2 + 1] * (1.0f / 32768.0f);
+                voice->position += player->step;
+            }
+            if (i == start) voice->active = false;
+        }
+    }
+    SDL_AtomicUnlock(&player->lock);
+}
+
+// 注册雨声合成器；仅支持16位立体声输出，其他格式下不启用
+void init_rain_synth() {
+    int frequency = 0;
+    Uint16 format = 0;
+    int channels = 0;
+    if (!Mix_QuerySpec(&frequency, &format, &channels) || format != AUDIO_S16SYS || channels != 2) {
+        printf("警告：音频格式不支持雨声合成，雨声和雷声已禁用。\n");
+        return;
+    }
+    rain_synth.sample_rate = frequency;
+    rain_synth.enabled = true;
+    Mix_SetPostMix(rain_synth_postmix, &rain_synth);
+}
+
+// 生成一个新的雨声颗粒：起始时刻在本缓冲区内随机，声像按落水点的水平分布抽样
+static void spawn_rain_grain(RainSynth* synth, int frames) {
+    if (synth->grain_count >= RAIN_SYNTH_MAX_GRAINS) return;
+    RainGrain* g = &synth->grains[synth->grain_count++];
+    
+    float pick = rng_float(&synth->grain_rng);
+    int bin = 0;
+    while (bin < RAIN_SYNTH_PAN_BINS - 1 && pick >= synth->current.pan[bin]) {
+        pick -= synth->current.pan[bin];
+        bin++;
+    }
+    float pan = (bin + rng_float(&synth->grain_rng)) / RAIN_SYNTH_PAN_BINS;
+    
+    // 近处的雨点更响、更明亮，衰减时间约 5-25 毫秒
+    float level = synth->current.loudness * (0.3f + 0.7f * rng_float(&synth->grain_rng));
+    float decay_ms = 5.0f + 20.0f * rng_float(&synth->grain_rng);
+    g->amp = 0.25f * level;
+    g->decay = expf(-1000.0f / (decay_ms * synth->sample_rate));
+    g->gain_l = sqrtf(1.0f - pan);
+    g->gain_r = sqrtf(pan);
+    g->lp = 0.0f;
+    g->lp_coef = 0.2f + 0.6f * level;
+    g->start = rng_int(&synth->grain_rng, frames);
+    g->noise_offset = rng_int(&synth->grain_rng, frames);
+}
+
+// 合成一段雨声到 synth->mix（交错的左右声道），frames 不超过 AUDIO_BUFFER_FRAMES
+static void rain_synth_render(RainSynth* synth, int frames) {
+    // 参数平滑：约0.3秒内跟上主线程的最新值，避免按帧跳变
+    RainSynthParams target;
+    SDL_AtomicLock(&synth->lock);
+    target = synth->target;
+    SDL_AtomicUnlock(&synth->lock);
+    float k = frames / (0.3f * synth->sample_rate);
+    if (k > 1.0f) k = 1.0f;
+    RainSynthParams* cur = &synth->current;
+    cur->rate += (target.rate - cur->rate) * k;
+    cur->loudness += (target.loudness - cur->loudness) * k;
+    for (int i = 0; i < RAIN_SYNTH_PAN_BINS; i++) {
+        cur->pan[i] += (target.pan[i] - cur->pan[i]) * k;
+    }
+    
+    // 整段噪声一次批量生成：前两段给左右声道底噪，第三段给颗粒
+    rng_fill_floats(&synth->noise_rng, synth->noise, frames * 3, -1.0f, 1.0f);
+    const float* noise_l = synth->noise;
+    const float* noise_r = synth->noise + frames;
+    const float* grain_noise = synth->noise + frames * 2;
+    
+    // 底噪：带通滤波的噪声，音量随落水速率的平方根增长，左右平衡取落水点分布
+    float density = sqrtf(cur->rate / RAIN_SYNTH_REF_RATE);
+    if (density > 1.0f) density = 1.0f;
+    float bed_gain = 0.12f * density * cur->loudness;
+    float right = 0.0f;
+    for (int i = 0; i < RAIN_SYNTH_PAN_BINS; i++) {
+        right += cur->pan[i] * (i + 0.5f) / RAIN_SYNTH_PAN_BINS;
+    }
+    if (cur->rate <= 0.0f) right = 0.5f;
+    float bed_l = bed_gain * sqrtf(1.0f - right);
+    float bed_r = bed_gain * sqrtf(right);
+    float lp_l = synth->bed_lp[0], lp_r = synth->bed_lp[1];
+    float hp_l = synth->bed_hp[0], hp_r = synth->bed_hp[1];
+    for (int i = 0; i < frames; i++) {
+        lp_l += (noise_l[i] - lp_l) * 0.35f;
+        lp_r += (noise_r[i] - lp_r) * 0.35f;
+        hp_l += (lp_l - hp_l) * 0.04f;
+        hp_r += (lp_r - hp_r) * 0.04f;
+        synth->mix[i * 2] = (lp_l - hp_l) * bed_l;
+        synth->mix[i * 2 + 1] = (lp_r - hp_r) * bed_r;
+    }
+    synth->bed_lp[0] = lp_l;
+    synth->bed_lp[1] = lp_r;
+    synth->bed_hp[0] = hp_l;
+    synth->bed_hp[1] = hp_r;
+    
+    // 颗粒：稀疏的雨点声，速率有上限，更密的雨由底噪表现
+    float grain_rate = cur->rate < RAIN_SYNTH_GRAIN_RATE ? cur->rate : RAIN_SYNTH_GRAIN_RATE;
+    synth->grain_debt += grain_rate * frames / synth->sample_rate;
+    while (synth->grain_debt >= 1.0f) {
+        spawn_rain_grain(synth, frames);
+        synth->grain_debt -= 1.0f;
+    }
+    for (int n = 0; n < synth->grain_count; ) {
+        RainGrain* g = &synth->grains[n];
+        float amp = g->amp, lp = g->lp;
+        int src = (g->start + g->noise_offset) % frames;
+        for (int i = g->start; i < frames; i++) {
+            lp += (grain_noise[src] - lp) * g->lp_coef;
+            if (++src == frames) src = 0;
+            synth->mix[i * 2] += lp * amp * g->gain_l;
+            synth->mix[i * 2 + 1] += lp * amp * g->gain_r;
+            amp *= g->decay;
+        }
+        g->amp = amp;
+        g->lp = lp;
+        g->start = 0;
+        // 衰减完的颗粒用末尾的颗粒填补
+        if (amp < 0.0005f) {
+            *g = synth->grains[--synth->grain_count];
+        } else {
+            n++;
+        }
+    }
+}
+
+// SDL_mixer后期混音回调（音频线程）：把合成的雨声和流式解码的雷声叠加到已混好的输出上
+void rain_synth_postmix(void* udata, Uint8* stream, int len) {
+    RainSynth* synth = (RainSynth*)udata;
+    Sint16* out = (Sint16*)stream;
+    int total = len / (int)(2 * sizeof(Sint16));
+    
+    for (int done = 0; done < total; ) {
+        int frames = total - done;
+        if (frames > AUDIO_BUFFER_FRAMES) frames = AUDIO_BUFFER_FRAMES;
+        rain_synth_render(synth, frames);
+        thunder_render(&thunder, synth->mix, frames);
+        
+        // 转换为整数（向零取整）后与原样本相加，再饱和为16位；SIMD与标量两条路径结果一致
+        Sint16* dst = out + done * 2;
+        int samples = frames * 2;
+        int i = 0;
+#if defined(SIMD_SSE2)
+        __m128 scale = _mm_set1_ps(32767.0f);
+        for (; i + 8 <= samples; i += 8) {
+            __m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_load_ps(synth->mix + i), scale));
+            __m128i b = _mm_cvttps_epi32(_mm_mul_ps(_mm_load_ps(synth->mix + i + 4), scale));
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            // 原样本符号扩展到32位
+            a = _mm_add_epi32(a, _mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16));
+            b = _mm_add_epi32(b, _mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+        }
+#endif
+        for (; i < samples; i++) {
+            int v = dst[i] + (int)(synth->mix[i] * 32767.0f);
+            if (v > 32767) v = 32767;
+            if (v < -32768) v = -32768;
+            dst[i] = (Sint16)v;
+        }
+        done += frames;
+    }
+}
+
+// 回收涟漪：用末尾的存活涟漪填补空位
+void remove_ripple(int index) {
+    ripples[index] = ripples[--ripple_count];
+}
+
+void create_splash(float x, float y, float z, SDL_Color color, Uint32 current_time) {
+    // 雨滴打在荷叶上的声音
+    queue_splash_sound(x, z);
+    
+    // 创建多个溅射水珠
+    int bead_count = 5 + rng_int(&particle_rng, 8); // 5-12个水珠
+    
+    // 根据强度增加水珠数量，画质调节器降低画质时减少（至少一个）
+    bead_count = (int)(bead_count * (1.0f + weather_intensity / 100.0f) * current_quality()->splash_beads);
+    if (bead_count < 1) bead_count = 1;
+    
+    // 水珠池剩余容量不足时只创建放得下的部分
+    if (bead_count > max_splashes - splash_count) {
+        bead_count = max_splashes - splash_count;
+    }
+    
+    for (int i = 0; i < bead_count; i++) {
+        Splash* splash = &splashes[splash_count++];
+        splash->x = x;
+        splash->y = y;
+        splash->z = z;
+        splash->prev_x = x;
+        splash->prev_y = y;
+        
+        // 随机速度方向，创造圆形溅射效果
+        float angle = rng_float(&particle_rng) * 6.28f; // 0-2π
+        
+        // 根据天气强度调整速度
+        float intensity_factor = 1.0f + (weather_intensity / 100.0f);
+        float speed = (50.0f + rng_float(&particle_rng) * 150.0f) * intensity_factor; // 50-200，受强度影响
+        
+        // 风会影响水珠方向
+        angle += wind_strength * 0.5f;
+        
+        splash->speed_x = fast_cosf(angle) * speed;
+        splash->speed_y = fast_sinf(angle) * speed - 200.0f; // 初始向上的趋势
+        
+        splash->size = 1.0f + rng_float(&particle_rng) * 2.0f; // 1-3
+        splash->color = color;
+        splash->creation_time = current_time;
+    }
+}
+
+// 回收水珠：用末尾的存活水珠填补空位
+void remove_splash(int index) {
+    splashes[index] = splashes[--splash_count];
+}
+
+void create_lightning(int x, int y, int segments, int width, int type, Uint32 current_time) {
+    // 查找未使用的闪电槽位
+    for (int i = 0; i < MAX_LIGHTNING; i++) {
+        if (!lightnings[i].active) {
             lightnings[i].active = true;
             lightnings[i].segments = segments;
             lightnings[i].width = width;
             lightnings[i].type = type;
             
             // 亮度受天气强度影响
-            lightnings[i].brightness = 180 + rand() % 75 + weather_intensity / 2; // 180-255 + 强度影响
+            lightnings[i].brightness = 180 + rng_int(&lightning_rng, 75) + weather_intensity / 2; // 180-255 + 强度影响
             if (lightnings[i].brightness > 255) lightnings[i].brightness = 255;
             
-            lightnings[i].creation_time = SDL_GetTicks();
+            lightnings[i].creation_time = current_time;
             
             // 根据强度调整闪电持续时间
             float duration_factor = 1.0f + (weather_intensity / 100.0f);
-            lightnings[i].duration = (int)((100 + rand() % 200) * duration_factor); // 100-300ms，受强度影响
+            lightnings[i].duration = (int)((100 + rng_int(&lightning_rng, 200)) * duration_factor); // 100-300ms，受强度影响
             
             // 设置闪电路径
             int current_x = x;
@@ -765,35 +3304,39 @@ void create_lightning(int x, int y, int segments, int width, int type) {
             
             for (int j = 1; j <= segments; j++) {
                 // 闪电路径随机偏移 - 受强度影响
-                current_x += (rand() % (int)zigzag_factor) - (int)(zigzag_factor / 2);
-                current_y += WINDOW_HEIGHT / segments;
+                current_x += (rng_int(&lightning_rng, (int)zigzag_factor)) - (int)(zigzag_factor / 2);
+                current_y += window_height / segments;
                 
-                if (current_y > POND_HEIGHT) current_y = POND_HEIGHT; // 不超过水面
+                if (current_y > pond_height) current_y = pond_height; // 不超过水面
                 
                 lightnings[i].points[j][0] = current_x;
                 lightnings[i].points[j][1] = current_y;
                 
                 // 随机生成分支闪电 - 受强度影响
-                if (type == 0 && segments > 3 && j > 1 && j < segments - 1 && rand() % 100 < branch_prob) {
+                if (type == 0 && segments > 3 && j > 1 && j < segments - 1 && rng_int(&lightning_rng, 100) < branch_prob) {
                     int branch_segments = segments / 2;
                     if (weather_intensity > 70) branch_segments += 1; // 高强度时分支更长
-                    create_lightning(current_x, current_y, branch_segments, width - 1, 1);
+                    create_lightning(current_x, current_y, branch_segments, width - 1, 1, current_time);
                 }
             }
             
+            // 主干闪电触发一次雷声，分支不再重复
+            if (type == 0) {
+                queue_thunder_sound();
+            }
             lightning_count++;
             return;
         }
     }
 }
 
-void initialize_moon() {
-    /* initialize moon texture */
+// 月亮：圆盘加三个陨石坑
+SDL_Surface* generate_moon_surface() {
     SDL_Surface* moon_surface = SDL_CreateRGBSurface(0, 80, 80, 32, 
         0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
     if (!moon_surface) {
         printf("无法创建月亮表面! SDL错误: %s\n", SDL_GetError());
-        return;
+        return NULL;
     }
     // 绘制月亮到表面
     SDL_FillRect(moon_surface, NULL, SDL_MapRGBA(moon_surface->format, 0,0,0,0)); // 透明背景
@@ -803,90 +3346,109 @@ void initialize_moon() {
     const int center_x = 40;
     const int center_y = 40;
     Uint32 moon_color = SDL_MapRGBA(moon_surface->format, 230,230,230,255);
-    for (int y = -moon_radius; y <= moon_radius; y++) {
-        for (int x = -moon_radius; x <= moon_radius; x++) {
-            if (x*x + y*y <= moon_radius*moon_radius) {
-                int px = center_x + x;
-                int py = center_y + y;
-                if (px >= 0 && px < 80 && py >= 0 && py < 80) {
-                    ((Uint32*)moon_surface->pixels)[py * moon_surface->pitch/4 + px] = moon_color;
-                }
-            }
-        }
-    }
+    fill_disc(moon_surface, center_x, center_y, moon_radius, moon_color);
     // 绘制陨石坑（预渲染到纹理）
     Uint32 crater_color = SDL_MapRGBA(moon_surface->format, 200,200,200,255);
     // 主陨石坑
-    draw_crater(moon_surface, 25, 30, 10, crater_color);
+    fill_disc(moon_surface, 25, 30, 10, crater_color);
     // 其他小陨石坑
-    draw_crater(moon_surface, 50, 35, 5, crater_color);
-    draw_crater(moon_surface, 35, 50, 7, crater_color);
+    fill_disc(moon_surface, 50, 35, 5, crater_color);
+    fill_disc(moon_surface, 35, 50, 7, crater_color);
     SDL_UnlockSurface(moon_surface);
-    // 创建纹理
-    moon_texture = SDL_CreateTextureFromSurface(renderer, moon_surface);
-    SDL_FreeSurface(moon_surface);
-    if (!moon_texture) {
-        printf("无法创建月亮纹理! SDL错误: %s\n", SDL_GetError());
-        return;
-    }
+    return moon_surface;
 }
 
-void initialize_cloud() {
-    for (int layer = 0; layer < MAX_CLOUD_LAYERS; layer++) {
-        // 创建表面用于生成云纹理
-        SDL_Surface* cloud_surface = SDL_CreateRGBSurface(0, WINDOW_WIDTH*2, 200, 32, 
-            0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
-        SDL_FillRect(cloud_surface, NULL, SDL_MapRGBA(cloud_surface->format, 0,0,0,0));
-        
-        // 预生成云层数据（使用改进的噪声算法）
-        SDL_LockSurface(cloud_surface);
-        for (int x = 0; x < cloud_surface->w; x++) {
-            // 使用分形噪声生成更自然的云图案
-            float noise = 
-                0.50 * sin(x * 0.01 + layer*2) +
-                0.25 * cos(x * 0.03 + layer*5) +
-                0.15 * sin(x * 0.07 + layer*3) +
-                0.10 * cos(x * 0.13 + layer*7);
-            
-            int cloud_height = (int)(30 + noise * 40 + layer * 10);
-            Uint8 alpha = (Uint8)(100 + layer * 15);
-            
-            for (int y = 0; y < cloud_surface->h; y++) {
-                if(y < cloud_height) {
-                    ((Uint32*)cloud_surface->pixels)[y * cloud_surface->pitch/4 + x] = 
-                        SDL_MapRGBA(cloud_surface->format, 80-layer*10, 80-layer*10, 100-layer*10, 255);
-                }
-            }
+// row[x] = heights[x] > y ? color : 0，SIMD路径按比较结果做掩码，每次写入8/4个像素
+static void fill_row_below(Uint32* row, const int* heights, int w, int y, Uint32 color) {
+    int x = 0;
+#ifdef SIMD_AVX2
+    {
+        __m256i c8 = _mm256_set1_epi32((int)color);
+        __m256i y8 = _mm256_set1_epi32(y);
+        for (; x + 8 <= w; x += 8) {
+            __m256i mask = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(heights + x)), y8);
+            _mm256_storeu_si256((__m256i*)(row + x), _mm256_and_si256(mask, c8));
         }
-        SDL_UnlockSurface(cloud_surface);
-        
-        // 转换为纹理并保存
-        cloud_textures[layer] = SDL_CreateTextureFromSurface(renderer, cloud_surface);
+    }
+#endif
+#ifdef SIMD_SSE2
+    {
+        __m128i c4 = _mm_set1_epi32((int)color);
+        __m128i y4 = _mm_set1_epi32(y);
+        for (; x + 4 <= w; x += 4) {
+            __m128i mask = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i*)(heights + x)), y4);
+            _mm_storeu_si128((__m128i*)(row + x), _mm_and_si128(mask, c4));
+        }
+    }
+#endif
+    for (; x < w; x++) {
+        row[x] = heights[x] > y ? color : 0;
+    }
+}
+
+// 一层云：宽度为窗口的两倍，水平滚动时循环使用
+SDL_Surface* generate_cloud_surface(int layer) {
+    // 创建表面用于生成云纹理
+    SDL_Surface* cloud_surface = SDL_CreateRGBSurface(0, window_width*2, 200, 32, 
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (!cloud_surface) {
+        printf("无法创建云层表面! SDL错误: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_FillRect(cloud_surface, NULL, SDL_MapRGBA(cloud_surface->format, 0,0,0,0));
+    
+    // 预生成云层数据（使用改进的噪声算法），先求出每一列的云高
+    int* cloud_heights = malloc(sizeof(int) * cloud_surface->w);
+    if (!cloud_heights) {
+        printf("无法分配云层高度数组\n");
         SDL_FreeSurface(cloud_surface);
-        cloud_offsets[layer] = 0;
-    }    
+        return NULL;
+    }
+    int max_height = 0;
+    for (int x = 0; x < cloud_surface->w; x++) {
+        // 使用分形噪声生成更自然的云图案
+        float noise = 
+            0.50 * sin(x * 0.01 + layer*2) +
+            0.25 * cos(x * 0.03 + layer*5) +
+            0.15 * sin(x * 0.07 + layer*3) +
+            0.10 * cos(x * 0.13 + layer*7);
+        
+        cloud_heights[x] = (int)(30 + noise * 40 + layer * 10);
+        if (cloud_heights[x] > max_height) max_height = cloud_heights[x];
+    }
+    
+    // 再逐行写入：云高大于行号的像素为云色，其余保持透明
+    Uint32 cloud_color = SDL_MapRGBA(cloud_surface->format, 80-layer*10, 80-layer*10, 100-layer*10, 255);
+    SDL_LockSurface(cloud_surface);
+    for (int y = 0; y < max_height && y < cloud_surface->h; y++) {
+        fill_row_below((Uint32*)((Uint8*)cloud_surface->pixels + y * cloud_surface->pitch), cloud_heights,
+                       cloud_surface->w, y, cloud_color);
+    }
+    SDL_UnlockSurface(cloud_surface);
+    free(cloud_heights);
+    return cloud_surface;
 }
 
 void initialize_stars() {
-    for (int i = 0; i < STARS_COUNT; i++) {
-        stars[i].z = (float)rand() / RAND_MAX; // 随机深度 (0-1)
+    for (int i = 0; i < stars_count; i++) {
+        stars[i].z = rng_float(&scene_rng); // 随机深度 (0-1)
         
         // 根据深度，远处星星的分布范围更大
         float z_width_scale = 1.0f + (1.0f - stars[i].z) * 3.0f;
-        stars[i].x = (rand() % (int)(WINDOW_WIDTH * z_width_scale)) - 
-                     ((z_width_scale - 1.0f) * WINDOW_WIDTH / 2);
-        stars[i].y = rand() % POND_HEIGHT;
-        stars[i].brightness = 0.5f + ((float)rand() / RAND_MAX) * 0.5f;  // 亮度在0.5到1.0之间
-        stars[i].twinkle_speed = 0.5f + ((float)rand() / RAND_MAX) * 2.0f;  // 闪烁速度在0.5到2.5之间
+        stars[i].x = (rng_int(&scene_rng, (int)(window_width * z_width_scale))) - 
+                     ((z_width_scale - 1.0f) * window_width / 2);
+        stars[i].y = rng_int(&scene_rng, pond_height);
+        stars[i].brightness = 0.5f + rng_float(&scene_rng) * 0.5f;  // 亮度在0.5到1.0之间
+        stars[i].twinkle_speed = 0.5f + rng_float(&scene_rng) * 2.0f;  // 闪烁速度在0.5到2.5之间
     }
 }
 
 void initialize_mountains() {
     for (int i = 0; i < MOUNTAIN_COUNT; i++) {
         mountains[i].z = 0.1f + (float)i / (MOUNTAIN_COUNT - 1) * 0.5f; // 深度从0.1到0.6按顺序递增
-        mountains[i].x_offset = -WINDOW_WIDTH/2 + rand() % WINDOW_WIDTH; // 随机X偏移
-        mountains[i].height = (int)(100 + (rand() % 100) * mountains[i].z); // 远处的山低，近处的山高
-        mountains[i].width = (int)(200 + rand() % 300); // 随机宽度
+        mountains[i].x_offset = -window_width/2 + rng_int(&scene_rng, window_width); // 随机X偏移
+        mountains[i].height = (int)(100 + rng_int(&scene_rng, 100) * mountains[i].z); // 远处的山低，近处的山高
+        mountains[i].width = (int)(200 + rng_int(&scene_rng, 300)); // 随机宽度
         
         // 颜色从远到近由深变浅
         Uint8 color_value = (Uint8)(40 + mountains[i].z * 60);
@@ -897,29 +3459,59 @@ void initialize_mountains() {
     }
 }
 
+// 预渲染山体剪影：从山顶到山脚逐行加宽的三角形，涂成白色，
+// 绘制时用颜色调制得到山的颜色，闪电时再以加色混合叠加闪电亮度
+SDL_Surface* generate_mountain_surface(const Mountain *mountain) {
+    int half_width = mountain->width / 2;
+    int tex_w = half_width * 2 + 1;
+    int tex_h = mountain->height + 1;
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, tex_w, tex_h, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (!surface) {
+        printf("无法创建山体表面! SDL错误: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, 0, 0, 0, 0)); // 透明背景
+    
+    Uint32 white = SDL_MapRGBA(surface->format, 255, 255, 255, 255);
+    for (int y = 0; y < tex_h; y++) {
+        float height_ratio = (float)y / mountain->height;
+        int current_width = (int)(mountain->width * height_ratio);
+        if (current_width <= 0) continue;
+        
+        SDL_Rect line_rect = {half_width - current_width / 2, y, current_width / 2 * 2 + 1, 1};
+        SDL_FillRect(surface, &line_rect, white);
+    }
+    return surface;
+}
+
 void initialize_reeds() {
     for (int i = 0; i < REED_COUNT; i++) {
-        reeds[i].z = 0.5f + ((float)rand() / RAND_MAX) * 0.5f; // 随机深度 (0.5-1.0)较近的位置
+        reeds[i].z = 0.5f + rng_float(&scene_rng) * 0.5f; // 随机深度 (0.5-1.0)较近的位置
         
         // 分布在水域边缘
         float edge_variance = 50.0f; // 岸边区域大小
-        reeds[i].x = rand() % WINDOW_WIDTH;
-        reeds[i].y = POND_HEIGHT - 5 + (rand() % 10); // 岸边位置上下浮动
+        reeds[i].x = rng_int(&scene_rng, window_width);
+        reeds[i].y = pond_height - 5 + rng_int(&scene_rng, 10); // 岸边位置上下浮动
         
         // 大小和摇摆参数
-        reeds[i].height = (int)(30 + rand() % 30 * reeds[i].z); // 高度随深度增加
-        reeds[i].sway_offset = ((float)rand() / RAND_MAX) * 6.28f; // 随机相位 (0-2π)
-        reeds[i].sway_speed = 0.5f + ((float)rand() / RAND_MAX) * 1.5f; // 随机摇摆速度
+        reeds[i].height = (int)(30 + rng_int(&scene_rng, 30) * reeds[i].z); // 高度随深度增加
+        reeds[i].sway_offset = rng_float(&scene_rng) * 6.28f; // 随机相位 (0-2π)
+        reeds[i].sway_speed = 0.5f + rng_float(&scene_rng) * 1.5f; // 随机摇摆速度
     }
 }
 
-void generate_lotus_texture(LotusPad* pad) {
+SDL_Surface* generate_lotus_surface(const LotusPad* pad) {
     int radius = (int)pad->radius;
     int tex_size = radius * 2 + 2;
     
     // 创建表面
     SDL_Surface* surface = SDL_CreateRGBSurface(0, tex_size, tex_size, 32, 
         0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (!surface) {
+        printf("无法创建荷叶表面! SDL错误: %s\n", SDL_GetError());
+        return NULL;
+    }
     SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, 0,0,0,0));
     
     SDL_LockSurface(surface);
@@ -932,84 +3524,115 @@ void generate_lotus_texture(LotusPad* pad) {
     edge_color.r = (Uint8)(edge_color.r * 0.7f);
     edge_color.g = (Uint8)(edge_color.g * 0.7f);
     edge_color.b = (Uint8)(edge_color.b * 0.7f);
+    Uint32 edge_pixel = SDL_MapRGBA(surface->format, edge_color.r, edge_color.g, edge_color.b, 255);
+    
+    // 叶片轮廓：椭圆略带变形，采样角足够密，相邻两点在纹理上相距不到一个像素
+    int samples = (tex_size * 8 + 179) / 180 * 180;
+    float* rads = malloc(sizeof(float) * samples * 3);
+    if (!rads) {
+        printf("无法为荷叶纹理分配内存\n");
+        SDL_UnlockSurface(surface);
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+    float* angle_cos = rads + samples;
+    float* angle_sin = rads + samples * 2;
+    for (int k = 0; k < samples; k++) {
+        rads[k] = k * 6.28f / samples;
+    }
+    fast_cosf_array(rads, angle_cos, samples);
+    fast_sinf_array(rads, angle_sin, samples);
     
-    for (int angle = 0; angle < 360; angle += 2) {
-        float rad = angle * 3.14f / 180.0f;
-        float x = radius * cosf(rad) * (1.0f - 0.2f * sinf(rad));
-        float y = radius * sinf(rad) * (1.0f + 0.1f * cosf(rad)) * 0.7;
+    // 边缘是每2度一个点的虚线
+    for (int k = 0; k < samples; k += samples / 180) {
+        float x = radius * angle_cos[k] * (1.0f - 0.2f * angle_sin[k]);
+        float y = radius * angle_sin[k] * (1.0f + 0.1f * angle_cos[k]) * 0.7;
         
         int px = center_x + (int)x;
         int py = center_y + (int)y;
         if (px >= 0 && px < tex_size && py >= 0 && py < tex_size) {
-            ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = 
-                SDL_MapRGBA(surface->format, edge_color.r, edge_color.g, edge_color.b, 255);
+            ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = edge_pixel;
         }
     }
     
-    // 填充内部
+    // 填充内部：轮廓缩小到半径0.95倍以内（原来按0.5步进描点时最外一圈），
+    // 沿轮廓记下每行最左和最右的像素，再整行填充，每个像素只写一次
     SDL_Color fill_color = pad->color;
-    for (float r = 0; r < radius * 0.95f; r += 0.5f) {
-        for (int angle = 0; angle < 360; angle += 2) {
-            float rad = angle * 3.14f / 180.0f;
-            float x = r * cosf(rad) * (1.0f - 0.2f * sinf(rad));
-            float y = r * sinf(rad) * (1.0f + 0.1f * cosf(rad)) * 0.7;
-            
-            int px = center_x + (int)x;
-            int py = center_y + (int)y;
-            if (px >= 0 && px < tex_size && py >= 0 && py < tex_size) {
-                ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = 
-                    SDL_MapRGBA(surface->format, fill_color.r, fill_color.g, fill_color.b, 255);
-            }
+    Uint32 fill_pixel = SDL_MapRGBA(surface->format, fill_color.r, fill_color.g, fill_color.b, 255);
+    float fill_radius = (ceilf(radius * 0.95f * 2.0f) - 1.0f) * 0.5f;
+    int* span_min = malloc(sizeof(int) * tex_size * 2);
+    int* span_max = span_min ? span_min + tex_size : NULL;
+    for (int y = 0; span_min && y < tex_size; y++) {
+        span_min[y] = tex_size;
+        span_max[y] = -1;
+    }
+    for (int k = 0; span_min && k < samples; k++) {
+        float x = fill_radius * angle_cos[k] * (1.0f - 0.2f * angle_sin[k]);
+        float y = fill_radius * angle_sin[k] * (1.0f + 0.1f * angle_cos[k]) * 0.7;
+        
+        int px = center_x + (int)x;
+        int py = center_y + (int)y;
+        if (py >= 0 && py < tex_size) {
+            if (px < span_min[py]) span_min[py] = px;
+            if (px > span_max[py]) span_max[py] = px;
+        }
+    }
+    for (int y = 0; span_min && y < tex_size; y++) {
+        int x0 = span_min[y] < 0 ? 0 : span_min[y];
+        int x1 = span_max[y] >= tex_size ? tex_size - 1 : span_max[y];
+        if (x0 <= x1) {
+            fill_span((Uint32*)surface->pixels + y * surface->pitch / 4, x0, x1, fill_pixel);
         }
     }
+    free(span_min);
+    free(rads);
     
     // 绘制叶脉
     SDL_Color vein_color = fill_color;
     vein_color.r = (Uint8)(vein_color.r * 0.8f);
     vein_color.g = (Uint8)(vein_color.g * 0.8f);
     vein_color.b = (Uint8)(vein_color.b * 0.8f);
+    Uint32 vein_pixel = SDL_MapRGBA(surface->format, vein_color.r, vein_color.g, vein_color.b, 255);
     
     for (int j = 0; j < 8; j++) {
         float angle = j * 3.14f / 4.0f;
+        float vein_cos = fast_cosf(angle);
+        float vein_sin = fast_sinf(angle);
         for (float r = 0; r < radius * 0.9f; r += 0.5f) {
-            int px = center_x + (int)(r * cosf(angle));
-            int py = center_y + (int)(r * sinf(angle)) * 0.7;
+            int px = center_x + (int)(r * vein_cos);
+            int py = center_y + (int)(r * vein_sin) * 0.7;
             if (px >= 0 && px < tex_size && py >= 0 && py < tex_size) {
-                ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = 
-                    SDL_MapRGBA(surface->format, vein_color.r, vein_color.g, vein_color.b, 255);
+                ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = vein_pixel;
             }
         }
     }
     
     SDL_UnlockSurface(surface);
-    pad->texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
+    return surface;
 }
 
 void initialize_lotus_pads() {
-    for (int i = 0; i < LOTUS_PAD_COUNT; i++) {
-        lotus_pads[i].z = 0.3f + ((float)rand() / RAND_MAX) * 0.7f; // 随机深度 (0.3-1.0)
+    for (int i = 0; i < lotus_pad_count; i++) {
+        lotus_pads[i].z = 0.3f + rng_float(&scene_rng) * 0.7f; // 随机深度 (0.3-1.0)
         
         // 在水面随机分布
         float z_width_scale = 1.0f + (1.0f - lotus_pads[i].z) * 1.5f;
-        lotus_pads[i].x = (rand() % (int)(WINDOW_WIDTH * z_width_scale)) - 
-                         ((z_width_scale - 1.0f) * WINDOW_WIDTH / 2);
-        lotus_pads[i].y = POND_HEIGHT + 10 + rand() % (WINDOW_HEIGHT - POND_HEIGHT - 20);
+        lotus_pads[i].x = (rng_int(&scene_rng, (int)(window_width * z_width_scale))) - 
+                         ((z_width_scale - 1.0f) * window_width / 2);
+        lotus_pads[i].y = pond_height + 10 + rng_int(&scene_rng, window_height - pond_height - 20);
         
         // 大小和波动参数
         float z_scale = get_z_scale(lotus_pads[i].z);
-        lotus_pads[i].radius = (15.0f + rand() % 20) * z_scale; // 荷叶半径随深度变化
-        lotus_pads[i].wave_phase = ((float)rand() / RAND_MAX) * 6.28f; // 随机波动初相
-        lotus_pads[i].wave_speed = 0.5f + ((float)rand() / RAND_MAX); // 随机波动速度
-        lotus_pads[i].tilt_angle = ((float)rand() / RAND_MAX) * 0.3f; // 随机倾斜角度
+        lotus_pads[i].radius = (15.0f + rng_int(&scene_rng, 20)) * z_scale; // 荷叶半径随深度变化
+        lotus_pads[i].wave_phase = rng_float(&scene_rng) * 6.28f; // 随机波动初相
+        lotus_pads[i].wave_speed = 0.5f + rng_float(&scene_rng); // 随机波动速度
+        lotus_pads[i].tilt_angle = rng_float(&scene_rng) * 0.3f; // 随机倾斜角度
         
         // 荷叶颜色 - 深绿色
-        lotus_pads[i].color.r = 30 + rand() % 20;
-        lotus_pads[i].color.g = 100 + rand() % 50;
-        lotus_pads[i].color.b = 30 + rand() % 20;
+        lotus_pads[i].color.r = 30 + rng_int(&scene_rng, 20);
+        lotus_pads[i].color.g = 100 + rng_int(&scene_rng, 50);
+        lotus_pads[i].color.b = 30 + rng_int(&scene_rng, 20);
         lotus_pads[i].color.a = 255;
-
-        generate_lotus_texture(&lotus_pads[i]);
     }
 }
 
@@ -1033,7 +3656,7 @@ void render_lotus_texture(LotusPad* pad, int proj_x, float tilt) {
 }
 
 void destroy_lotus_textures() {
-    for (int i = 0; i < LOTUS_PAD_COUNT; i++) {
+    for (int i = 0; i < lotus_pad_count; i++) {
         if (lotus_pads[i].texture) {
             SDL_DestroyTexture(lotus_pads[i].texture);
             lotus_pads[i].texture = NULL;
@@ -1041,40 +3664,475 @@ void destroy_lotus_textures() {
     }
 }
     
+// 涟漪精灵的中心到边缘的距离：左右留出2个像素给半径小于2时的内圈
+static int ripple_sprite_half_width(int radius) {
+    return radius + 2;
+}
+
+static int ripple_sprite_half_height(int radius, float ellipse_factor) {
+    return (int)ceilf((radius + 2) * ellipse_factor) + 1;
+}
+
+static float ripple_sprite_ellipse(int step) {
+    return 0.3f + 0.2f * step / (RIPPLE_SPRITE_ELLIPSE_STEPS - 1);
+}
+
+// 预渲染涟漪图集：每个半径和椭圆压缩系数一个精灵，逐行排列
+// 排布涟漪图集中各精灵的位置，确定图集高度（从缓存载入图集时同样需要）
+void layout_ripple_sprites() {
+    int x = 0, y = 0, row_height = 0;
+    for (int e = 0; e < RIPPLE_SPRITE_ELLIPSE_STEPS; e++) {
+        float ellipse_factor = ripple_sprite_ellipse(e);
+        for (int radius = 0; radius <= RIPPLE_SPRITE_MAX_RADIUS; radius++) {
+            int w = ripple_sprite_half_width(radius) * 2 + 1;
+            int h = ripple_sprite_half_height(radius, ellipse_factor) * 2 + 1;
+            if (x + w > RIPPLE_ATLAS_WIDTH) {
+                x = 0;
+                y += row_height;
+                row_height = 0;
+            }
+            SDL_Rect rect = {x, y, w, h};
+            ripple_sprites[e][radius] = rect;
+            x += w;
+            if (h > row_height) row_height = h;
+        }
+    }
+    ripple_atlas_height = y + row_height;
+}
+
+// 每个精灵与原来的逐点绘制相同：半径 r-2 到 r 的三个圆环，每5度一个点
+SDL_Surface* generate_ripple_atlas_surface() {
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, RIPPLE_ATLAS_WIDTH, ripple_atlas_height, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (!surface) {
+        printf("无法创建涟漪图集表面! SDL错误: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, 0, 0, 0, 0)); // 透明背景
+    SDL_LockSurface(surface);
+    Uint32 white = SDL_MapRGBA(surface->format, 255, 255, 255, 255);
+    // 每5度一个点，所有圆环共用同一组正弦和余弦
+    float rads[72], angle_cos[72], angle_sin[72];
+    for (int k = 0; k < 72; k++) {
+        rads[k] = k * 5 * 3.14159f / 180.0f;
+    }
+    fast_cosf_array(rads, angle_cos, 72);
+    fast_sinf_array(rads, angle_sin, 72);
+    for (int e = 0; e < RIPPLE_SPRITE_ELLIPSE_STEPS; e++) {
+        float ellipse_factor = ripple_sprite_ellipse(e);
+        for (int radius = 0; radius <= RIPPLE_SPRITE_MAX_RADIUS; radius++) {
+            SDL_Rect* rect = &ripple_sprites[e][radius];
+            int cx = rect->x + ripple_sprite_half_width(radius);
+            int cy = rect->y + ripple_sprite_half_height(radius, ellipse_factor);
+            for (int r = radius - 2; r <= radius; r++) {
+                for (int k = 0; k < 72; k++) {
+                    int px = cx + (int)floorf(r * angle_cos[k]);
+                    int py = cy + (int)floorf(r * ellipse_factor * angle_sin[k]);
+                    ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = white;
+                }
+            }
+        }
+    }
+    SDL_UnlockSurface(surface);
+    return surface;
+}
+
+// 预渲染闪电光晕：一行白色像素，透明度从中心向两侧按高斯曲线衰减，
+// 绘制时沿闪电路径拉伸，相当于对粗线条做了一次横向模糊
+SDL_Surface* generate_lightning_glow_surface() {
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, LIGHTNING_GLOW_SIZE, 1, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (!surface) {
+        printf("无法创建闪电光晕表面! SDL错误: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_LockSurface(surface);
+    for (int x = 0; x < LIGHTNING_GLOW_SIZE; x++) {
+        float d = (x + 0.5f) / LIGHTNING_GLOW_SIZE * 2.0f - 1.0f;  // -1 到 1
+        Uint8 alpha = (Uint8)(255.0f * expf(-d * d * 4.0f));
+        ((Uint32*)surface->pixels)[x] = SDL_MapRGBA(surface->format, 255, 255, 255, alpha);
+    }
+    SDL_UnlockSurface(surface);
+    return surface;
+}
+
+// 闪电路径按水平方向加宽成三角形条带：每个路径点左右各一个顶点，
+// 相邻两点之间两个三角形；主体和光晕各一次 SDL_RenderGeometry
+void render_lightning_bolt(const Lightning* bolt) {
+    SDL_Vertex vertices[LIGHTNING_MAX_POINTS * 2];
+    int indices[(LIGHTNING_MAX_POINTS - 1) * 6];
+    int point_count = bolt->segments + 1;
+    if (point_count > LIGHTNING_MAX_POINTS) point_count = LIGHTNING_MAX_POINTS;
+    if (point_count < 2) return;
+    
+    int index_count = 0;
+    for (int j = 0; j + 1 < point_count; j++) {
+        int v = j * 2;
+        indices[index_count++] = v;
+        indices[index_count++] = v + 1;
+        indices[index_count++] = v + 2;
+        indices[index_count++] = v + 1;
+        indices[index_count++] = v + 3;
+        indices[index_count++] = v + 2;
+    }
+    
+    // 主体：不透明的粗线条，覆盖 [-width, width] 的像素
+    SDL_Color core_color = {bolt->brightness, bolt->brightness, bolt->brightness, 255};
+    float core_half = bolt->width + 0.5f;
+    for (int j = 0; j < point_count; j++) {
+        float x = bolt->points[j][0] + 0.5f;
+        float y = (float)bolt->points[j][1];
+        vertices[j * 2] = (SDL_Vertex){{x - core_half, y}, core_color, {0.0f, 0.0f}};
+        vertices[j * 2 + 1] = (SDL_Vertex){{x + core_half, y}, core_color, {0.0f, 0.0f}};
+    }
+    SDL_RenderGeometry(renderer, NULL, vertices, point_count * 2, indices, index_count);
+    
+    // 光晕：把模糊条带拉伸到主体宽度的4倍，横向纹理坐标从0到1
+    if (lightning_glow == NULL) return;
+    SDL_Color glow_color = {bolt->brightness, bolt->brightness, bolt->brightness, 90};
+    float glow_half = bolt->width * 4.0f + 0.5f;
+    for (int j = 0; j < point_count; j++) {
+        float x = bolt->points[j][0] + 0.5f;
+        float y = (float)bolt->points[j][1];
+        float v = (float)j / (point_count - 1);
+        vertices[j * 2] = (SDL_Vertex){{x - glow_half, y}, glow_color, {0.0f, v}};
+        vertices[j * 2 + 1] = (SDL_Vertex){{x + glow_half, y}, glow_color, {1.0f, v}};
+    }
+    SDL_RenderGeometry(renderer, lightning_glow, vertices, point_count * 2, indices, index_count);
+}
+
 void initialize_lotus_flowers() {
     for (int i = 0; i < LOTUS_FLOWER_COUNT; i++) {
-        lotus_flowers[i].z = 0.4f + ((float)rand() / RAND_MAX) * 0.6f; // 随机深度 (0.4-1.0)
+        lotus_flowers[i].z = 0.4f + rng_float(&scene_rng) * 0.6f; // 随机深度 (0.4-1.0)
         
         // 在水面随机分布
         float z_width_scale = 1.0f + (1.0f - lotus_flowers[i].z) * 1.5f;
-        lotus_flowers[i].x = (rand() % (int)(WINDOW_WIDTH * z_width_scale)) - 
-                           ((z_width_scale - 1.0f) * WINDOW_WIDTH / 2);
-        lotus_flowers[i].y = POND_HEIGHT + 10 + rand() % (WINDOW_HEIGHT - POND_HEIGHT - 20);
+        lotus_flowers[i].x = (rng_int(&scene_rng, (int)(window_width * z_width_scale))) - 
+                           ((z_width_scale - 1.0f) * window_width / 2);
+        lotus_flowers[i].y = pond_height + 10 + rng_int(&scene_rng, window_height - pond_height - 20);
         
         // 大小和摇摆参数
         float z_scale = get_z_scale(lotus_flowers[i].z);
-        lotus_flowers[i].size = (10.0f + rand() % 10) * z_scale; // 大小随深度变化
-        lotus_flowers[i].sway_phase = ((float)rand() / RAND_MAX) * 6.28f; // 随机摇摆初相
+        lotus_flowers[i].size = (10.0f + rng_int(&scene_rng, 10)) * z_scale; // 大小随深度变化
+        lotus_flowers[i].sway_phase = rng_float(&scene_rng) * 6.28f; // 随机摇摆初相
         
         // 荷花颜色 - 粉白色
-        lotus_flowers[i].color.r = 230 + rand() % 25;
-        lotus_flowers[i].color.g = 200 + rand() % 25;
-        lotus_flowers[i].color.b = 220 + rand() % 25;
+        lotus_flowers[i].color.r = 230 + rng_int(&scene_rng, 25);
+        lotus_flowers[i].color.g = 200 + rng_int(&scene_rng, 25);
+        lotus_flowers[i].color.b = 220 + rng_int(&scene_rng, 25);
         lotus_flowers[i].color.a = 255;
         
         // 花瓣数量
-        lotus_flowers[i].petal_count = 5 + rand() % 4; // 5-8花瓣
+        lotus_flowers[i].petal_count = 5 + rng_int(&scene_rng, 4); // 5-8花瓣
+        
+        // 动画帧中心到边缘的距离（花瓣最长 size，左右留出花瓣宽度）
+        lotus_flowers[i].frame_half_w = (int)ceilf(lotus_flowers[i].size * 1.5f) + 1;
+        lotus_flowers[i].frame_half_h = (int)ceilf(lotus_flowers[i].size) + 1;
+    }
+}
+
+// 预渲染荷花的旋转动画：花瓣图案每转过 2π/花瓣数 就重复一次，
+// 只需在这一段角度内均匀取 LOTUS_FLOWER_FRAMES 帧，按网格排列在一张纹理中
+SDL_Surface* generate_flower_surface(const LotusFlower *flower) {
+    int frame_w = flower->frame_half_w * 2 + 1;
+    int frame_h = flower->frame_half_h * 2 + 1;
+    int rows = (LOTUS_FLOWER_FRAMES + LOTUS_FLOWER_FRAME_COLUMNS - 1) / LOTUS_FLOWER_FRAME_COLUMNS;
+    
+    SDL_Surface* surface = SDL_CreateRGBSurface(0, frame_w * LOTUS_FLOWER_FRAME_COLUMNS, frame_h * rows, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (!surface) {
+        printf("无法创建荷花表面! SDL错误: %s\n", SDL_GetError());
+        return NULL;
+    }
+    SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, 0, 0, 0, 0)); // 透明背景
+    SDL_LockSurface(surface);
+    Uint32 petal_color = SDL_MapRGBA(surface->format, flower->color.r, flower->color.g, flower->color.b, 255);
+    Uint32 center_color = SDL_MapRGBA(surface->format, 255, 220, 0, 255);
+    
+    for (int f = 0; f < LOTUS_FLOWER_FRAMES; f++) {
+        int center_x = (f % LOTUS_FLOWER_FRAME_COLUMNS) * frame_w + flower->frame_half_w;
+        int center_y = (f / LOTUS_FLOWER_FRAME_COLUMNS) * frame_h + flower->frame_half_h;
+        float rotation = f * 6.28f / flower->petal_count / LOTUS_FLOWER_FRAMES;
+        
+        // 花瓣
+        for (int p = 0; p < flower->petal_count; p++) {
+            float angle = p * 6.28f / flower->petal_count + rotation;
+            float petal_cos = fast_cosf(angle);
+            float petal_sin = fast_sinf(angle);
+            for (int r = 0; r < flower->size; r++) {
+                float petal_width = fast_sinf(r / flower->size * 3.14f) * flower->size * 0.5f;
+                for (int w = -(int)petal_width; w <= (int)petal_width; w++) {
+                    int px = center_x + (int)(r * petal_cos) + w;
+                    int py = center_y + (int)(r * petal_sin);
+                    ((Uint32*)surface->pixels)[py * surface->pitch/4 + px] = petal_color;
+                }
+            }
+        }
+        
+        // 中心
+        int center_size = (int)(flower->size * 0.3f);
+        for (int y = -center_size; y <= center_size; y++) {
+            for (int x = -center_size; x <= center_size; x++) {
+                if (x*x + y*y <= center_size*center_size) {
+                    ((Uint32*)surface->pixels)[(center_y + y) * surface->pitch/4 + center_x + x] = center_color;
+                }
+            }
+        }
+    }
+    
+    SDL_UnlockSurface(surface);
+    return surface;
+}
+
+void destroy_flower_textures() {
+    for (int i = 0; i < LOTUS_FLOWER_COUNT; i++) {
+        if (lotus_flowers[i].texture) {
+            SDL_DestroyTexture(lotus_flowers[i].texture);
+            lotus_flowers[i].texture = NULL;
+        }
+    }
+}
+
+// 设定PCG32随机数流：相同的 seed 和 stream 总是产生相同的序列，不同 stream 互不相关
+void rng_seed(Rng* rng, Uint64 seed, Uint64 stream) {
+    rng->state = 0;
+    rng->inc = (stream << 1) | 1;
+    rng_next(rng);
+    rng->state += seed;
+    rng_next(rng);
+}
+
+Uint32 rng_next(Rng* rng) {
+    Uint64 old = rng->state;
+    rng->state = old * 6364136223846793005ULL + rng->inc;
+    Uint32 xorshifted = (Uint32)(((old >> 18) ^ old) >> 27);
+    Uint32 rot = (Uint32)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+// [0, n) 范围的整数（乘法取高位，避免取模）
+int rng_int(Rng* rng, int n) {
+    if (n <= 0) return 0;
+    return (int)(((Uint64)rng_next(rng) * (Uint32)n) >> 32);
+}
+
+// [0, 1) 范围的浮点数
+float rng_float(Rng* rng) {
+    return (rng_next(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// 用一个PCG流为批量生成器的8个通道播种
+void rng_bulk_seed(RngBulk* bulk, Rng* source) {
+    for (int i = 0; i < 8; i++) {
+        Uint32 x = rng_next(source);
+        bulk->lanes[i] = x ? x : 0x9E3779B9u;  // xorshift状态不能为0
+    }
+}
+
+// 批量生成 [lo, hi) 范围的浮点数：8个xorshift32通道并行推进，每轮产生8个
+// out 的容量需向上取整到8的倍数；各SIMD路径产生完全相同的序列
+void rng_fill_floats(RngBulk* bulk, float* out, int count, float lo, float hi) {
+    float scale = (hi - lo) * (1.0f / 16777216.0f);
+#if defined(SIMD_AVX2)
+    __m256i s = _mm256_load_si256((const __m256i*)bulk->lanes);
+    __m256 vscale = _mm256_set1_ps(scale);
+    __m256 vlo = _mm256_set1_ps(lo);
+    for (int i = 0; i < count; i += 8) {
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 13));
+        s = _mm256_xor_si256(s, _mm256_srli_epi32(s, 17));
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 5));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_srli_epi32(s, 8));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(f, vscale), vlo));
+    }
+    _mm256_store_si256((__m256i*)bulk->lanes, s);
+#elif defined(SIMD_SSE2)
+    __m128i s0 = _mm_load_si128((const __m128i*)bulk->lanes);
+    __m128i s1 = _mm_load_si128((const __m128i*)(bulk->lanes + 4));
+    __m128 vscale = _mm_set1_ps(scale);
+    __m128 vlo = _mm_set1_ps(lo);
+    for (int i = 0; i < count; i += 8) {
+        s0 = _mm_xor_si128(s0, _mm_slli_epi32(s0, 13));
+        s1 = _mm_xor_si128(s1, _mm_slli_epi32(s1, 13));
+        s0 = _mm_xor_si128(s0, _mm_srli_epi32(s0, 17));
+        s1 = _mm_xor_si128(s1, _mm_srli_epi32(s1, 17));
+        s0 = _mm_xor_si128(s0, _mm_slli_epi32(s0, 5));
+        s1 = _mm_xor_si128(s1, _mm_slli_epi32(s1, 5));
+        __m128 f0 = _mm_cvtepi32_ps(_mm_srli_epi32(s0, 8));
+        __m128 f1 = _mm_cvtepi32_ps(_mm_srli_epi32(s1, 8));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(f0, vscale), vlo));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(f1, vscale), vlo));
+    }
+    _mm_store_si128((__m128i*)bulk->lanes, s0);
+    _mm_store_si128((__m128i*)(bulk->lanes + 4), s1);
+#else
+    for (int i = 0; i < count; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            Uint32 x = bulk->lanes[j];
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            bulk->lanes[j] = x;
+            out[i + j] = (float)(x >> 8) * scale + lo;
+        }
+    }
+#endif
+}
+
+// 用同一个种子初始化所有随机数流
+void seed_random_streams(Uint64 seed) {
+    rng_seed(&scene_rng, seed, 1);
+    rng_seed(&weather_rng, seed, 2);
+    rng_seed(&spawn_rng, seed, 3);
+    rng_seed(&particle_rng, seed, 4);
+    rng_seed(&lightning_rng, seed, 5);
+    rng_seed(&render_rng, seed, 6);
+    
+    Rng bulk_source;
+    rng_seed(&bulk_source, seed, 7);
+    rng_bulk_seed(&rain_jitter_rng, &bulk_source);
+    rng_bulk_seed(&rain_spawn_rng, &bulk_source);
+    rng_bulk_seed(&rain_synth.noise_rng, &bulk_source);
+    rng_seed(&rain_synth.grain_rng, seed, 8);
+}
+
+// ==== 快速数学：正弦/余弦 ====
+// fast_sinf/fast_cosf：Cody-Waite 把参数约简到 [-π, π]，再利用对称性折到 [0, π/2]，
+// 用9次奇多项式（Remez 极小化）求值。多项式本身的误差 1.3e-8，加上单精度舍入，
+// |x| <= 1e4 时绝对误差不超过 3e-7；参数更大时约简误差随 |x| 增长，|x| 需小于 2^31。
+// table_sinf/table_cosf：同样约简后在 SIN_TABLE_SIZE 段的正弦表中线性插值，
+// 插值误差 (2π/N)^2/8 加上舍入不超过 5e-6，只做一次乘法、一次查表，适合每帧的动画。
+// *_array 版本对整个数组求值，SIMD路径与标量路径的运算顺序相同，结果逐位一致。
+
+#define FAST_PI 3.14159265f
+#define FAST_HALF_PI 1.57079633f
+#define FAST_INV_TWO_PI 0.159154943f
+#define FAST_TWO_PI_HI 6.28125f                 // 2π 的高位（低位为0，乘以整数时没有舍入）
+#define FAST_TWO_PI_LO 1.93530717958647692e-3f  // 2π - FAST_TWO_PI_HI
+#define FAST_SIN_C1 0.999999999f
+#define FAST_SIN_C3 -0.166666625f
+#define FAST_SIN_C5 8.33313078e-3f
+#define FAST_SIN_C7 -1.98134239e-4f
+#define FAST_SIN_C9 2.61253804e-6f
+
+float sin_table[SIN_TABLE_SIZE + 1];    // sin(2π i / N)，多一项避免插值时回绕
+
+void init_sin_table() {
+    for (int i = 0; i <= SIN_TABLE_SIZE; i++) {
+        sin_table[i] = (float)sin(i * 6.283185307179586 / SIN_TABLE_SIZE);
+    }
+}
+
+// 减去最接近的 2π 整数倍，结果在 [-π, π]
+static inline float reduce_two_pi(float x) {
+    float k = rintf(x * FAST_INV_TWO_PI);
+    return (x - k * FAST_TWO_PI_HI) - k * FAST_TWO_PI_LO;
+}
+
+static inline float sin_poly(float a) {
+    float a2 = a * a;
+    return a * (FAST_SIN_C1 + a2 * (FAST_SIN_C3 + a2 * (FAST_SIN_C5 + a2 * (FAST_SIN_C7 + a2 * FAST_SIN_C9))));
+}
+
+float fast_sinf(float x) {
+    float r = reduce_two_pi(x);
+    float a = fabsf(r);
+    float s = sin_poly(fminf(a, FAST_PI - a));     // sin(π - a) = sin(a)
+    return signbit(r) ? -s : s;                      // 奇函数；|r| 因舍入略大于π时 s 为负，同样成立
+}
+
+// cos(x) = sin(π/2 - |r|)，约简后再平移，避免 x + π/2 在 |x| 较大时丢失精度
+float fast_cosf(float x) {
+    return sin_poly(FAST_HALF_PI - fabsf(reduce_two_pi(x)));
+}
+
+// t 为以表格下标计的角度，可为负数
+static inline float sin_table_lerp(float t) {
+    float fl = floorf(t);
+    int i = (int)fl & (SIN_TABLE_SIZE - 1);
+    return sin_table[i] + (sin_table[i + 1] - sin_table[i]) * (t - fl);
+}
+
+float table_sinf(float x) {
+    return sin_table_lerp(reduce_two_pi(x) * (SIN_TABLE_SIZE * FAST_INV_TWO_PI));
+}
+
+float table_cosf(float x) {
+    return sin_table_lerp(reduce_two_pi(x) * (SIN_TABLE_SIZE * FAST_INV_TWO_PI) + SIN_TABLE_SIZE / 4);
+}
+
+// cosine 为假时 out[i] = fast_sinf(x[i])，否则 out[i] = fast_cosf(x[i])
+static void fast_trig_array(const float* x, float* out, int n, bool cosine) {
+    int i = 0;
+#ifdef SIMD_AVX2
+    {
+        __m256 inv = _mm256_set1_ps(FAST_INV_TWO_PI);
+        __m256 hi = _mm256_set1_ps(FAST_TWO_PI_HI);
+        __m256 lo = _mm256_set1_ps(FAST_TWO_PI_LO);
+        __m256 pi = _mm256_set1_ps(FAST_PI);
+        __m256 half_pi = _mm256_set1_ps(FAST_HALF_PI);
+        __m256 sign = _mm256_set1_ps(-0.0f);
+        for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(x + i);
+            __m256 k = _mm256_cvtepi32_ps(_mm256_cvtps_epi32(_mm256_mul_ps(v, inv)));
+            __m256 r = _mm256_sub_ps(_mm256_sub_ps(v, _mm256_mul_ps(k, hi)), _mm256_mul_ps(k, lo));
+            __m256 a = _mm256_andnot_ps(sign, r);
+            a = cosine ? _mm256_sub_ps(half_pi, a) : _mm256_min_ps(a, _mm256_sub_ps(pi, a));
+            __m256 a2 = _mm256_mul_ps(a, a);
+            __m256 p = _mm256_add_ps(_mm256_set1_ps(FAST_SIN_C7), _mm256_mul_ps(a2, _mm256_set1_ps(FAST_SIN_C9)));
+            p = _mm256_add_ps(_mm256_set1_ps(FAST_SIN_C5), _mm256_mul_ps(a2, p));
+            p = _mm256_add_ps(_mm256_set1_ps(FAST_SIN_C3), _mm256_mul_ps(a2, p));
+            p = _mm256_add_ps(_mm256_set1_ps(FAST_SIN_C1), _mm256_mul_ps(a2, p));
+            p = _mm256_mul_ps(a, p);
+            _mm256_storeu_ps(out + i, cosine ? p : _mm256_xor_ps(p, _mm256_and_ps(sign, r)));
+        }
+    }
+#endif
+#ifdef SIMD_SSE2
+    {
+        __m128 inv = _mm_set1_ps(FAST_INV_TWO_PI);
+        __m128 hi = _mm_set1_ps(FAST_TWO_PI_HI);
+        __m128 lo = _mm_set1_ps(FAST_TWO_PI_LO);
+        __m128 pi = _mm_set1_ps(FAST_PI);
+        __m128 half_pi = _mm_set1_ps(FAST_HALF_PI);
+        __m128 sign = _mm_set1_ps(-0.0f);
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(x + i);
+            __m128 k = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(v, inv)));
+            __m128 r = _mm_sub_ps(_mm_sub_ps(v, _mm_mul_ps(k, hi)), _mm_mul_ps(k, lo));
+            __m128 a = _mm_andnot_ps(sign, r);
+            a = cosine ? _mm_sub_ps(half_pi, a) : _mm_min_ps(a, _mm_sub_ps(pi, a));
+            __m128 a2 = _mm_mul_ps(a, a);
+            __m128 p = _mm_add_ps(_mm_set1_ps(FAST_SIN_C7), _mm_mul_ps(a2, _mm_set1_ps(FAST_SIN_C9)));
+            p = _mm_add_ps(_mm_set1_ps(FAST_SIN_C5), _mm_mul_ps(a2, p));
+            p = _mm_add_ps(_mm_set1_ps(FAST_SIN_C3), _mm_mul_ps(a2, p));
+            p = _mm_add_ps(_mm_set1_ps(FAST_SIN_C1), _mm_mul_ps(a2, p));
+            p = _mm_mul_ps(a, p);
+            _mm_storeu_ps(out + i, cosine ? p : _mm_xor_ps(p, _mm_and_ps(sign, r)));
+        }
+    }
+#endif
+    // 标量路径（没有SIMD时处理全部元素，否则只处理尾部）
+    for (; i < n; i++) {
+        out[i] = cosine ? fast_cosf(x[i]) : fast_sinf(x[i]);
     }
 }
 
+void fast_sinf_array(const float* x, float* out, int n) {
+    fast_trig_array(x, out, n, false);
+}
+
+void fast_cosf_array(const float* x, float* out, int n) {
+    fast_trig_array(x, out, n, true);
+}
+
 SDL_Color get_random_color() {
     SDL_Color color;
     // 生成适合雨滴的柔和颜色
-    color.r = 150 + rand() % 105;  // 150-255
+    color.r = 150 + rng_int(&spawn_rng, 105);  // 150-255
 
-    color.g = 150 + rand() % 105;  // 150-255
-    color.b = 150 + rand() % 105;  // 150-255
-    color.a = 150 + rand() % 105;  // 150-255 (半透明)
+    color.g = 150 + rng_int(&spawn_rng, 105);  // 150-255
+    color.b = 150 + rng_int(&spawn_rng, 105);  // 150-255
+    color.a = 150 + rng_int(&spawn_rng, 105);  // 150-255 (半透明)
     return color;
 }
 
@@ -1130,13 +4188,13 @@ float get_rain_interval(WeatherState weather, int intensity) {
     return base_interval * (1.0f - intensity / 200.0f); // 强度影响降至50%
 }
 
-void update_stars(Uint32 current_time) {
-    float time_seconds = current_time / 1000.0f;
+void update_stars(const FrameTime* ft) {
+    float time_seconds = ft->ms / 1000.0f;
     
-    for (int i = 0; i < STARS_COUNT; i++) {
+    for (int i = 0; i < stars_count; i++) {
         // 使用正弦函数来创建闪烁效果
         float phase = time_seconds * stars[i].twinkle_speed;
-        float sine_value = (sinf(phase) + 1.0f) / 2.0f;  // 将正弦值归一化到0-1范围
+        float sine_value = (table_sinf(phase) + 1.0f) / 2.0f;  // 将正弦值归一化到0-1范围
         stars[i].brightness = 0.5f + sine_value * 0.5f;  // 亮度在0.5到1.0之间变化
     }
 }
@@ -1156,16 +4214,18 @@ void update_camera() {
     }
 }
 
-void update_weather_and_wind(Uint32 current_time) {
+void update_weather_and_wind(const FrameTime* ft) {
+    Uint32 current_time = ft->ms;
+    
     // 检查是否应该切换天气状态
     Uint32 weather_duration = weather_duration_min + 
-                             rand() % (weather_duration_max - weather_duration_min);
+                             rng_int(&weather_rng, weather_duration_max - weather_duration_min);
     
     if (current_time - last_weather_change_time > weather_duration && 
         current_weather == target_weather) {
         // 随机选择新的目标天气，不同于当前天气
         do {
-            target_weather = (WeatherState)(rand() % WEATHER_COUNT);
+            target_weather = (WeatherState)rng_int(&weather_rng, WEATHER_COUNT);
         } while (target_weather == current_weather);
         
         last_weather_change_time = current_time;
@@ -1179,22 +4239,22 @@ void update_weather_and_wind(Uint32 current_time) {
         // 根据天气设置目标风强度
         switch (current_weather) {
             case WEATHER_LIGHT_RAIN:
-                target_wind_strength = -0.2f + ((float)rand() / RAND_MAX) * 0.4f; // -0.2 到 0.2
+                target_wind_strength = -0.2f + rng_float(&weather_rng) * 0.4f; // -0.2 到 0.2
                 break;
             case WEATHER_MEDIUM_RAIN:
-                target_wind_strength = -0.5f + ((float)rand() / RAND_MAX) * 1.0f; // -0.5 到 0.5
+                target_wind_strength = -0.5f + rng_float(&weather_rng) * 1.0f; // -0.5 到 0.5
                 break;
             case WEATHER_HEAVY_RAIN:
-                target_wind_strength = -0.8f + ((float)rand() / RAND_MAX) * 1.6f; // -0.8 到 0.8
+                target_wind_strength = -0.8f + rng_float(&weather_rng) * 1.6f; // -0.8 到 0.8
                 break;
             case WEATHER_THUNDERSTORM:
-                target_wind_strength = -1.0f + ((float)rand() / RAND_MAX) * 2.0f; // -1.0 到 1.0
+                target_wind_strength = -1.0f + rng_float(&weather_rng) * 2.0f; // -1.0 到 1.0
                 break;
         }
     }
     
     // 定期微调风强度，制造风力变化
-    if (rand() % 100 == 0) {
+    if (rng_int(&weather_rng, 100) == 0) {
         // 微调目标风力，但保持在当前天气的合理范围内
         float wind_variance = 0.0f;
         switch (current_weather) {
@@ -1215,7 +4275,7 @@ void update_weather_and_wind(Uint32 current_time) {
         // 增加强度对风的影响
         wind_variance *= (0.5f + weather_intensity / 100.0f);
         
-        target_wind_strength += (((float)rand() / RAND_MAX) * 2.0f - 1.0f) * wind_variance;
+        target_wind_strength += (rng_float(&weather_rng) * 2.0f - 1.0f) * wind_variance;
         
         // 限制风强度范围
         if (target_wind_strength > 1.0f) target_wind_strength = 1.0f;
@@ -1231,7 +4291,9 @@ void update_weather_and_wind(Uint32 current_time) {
     }
 }
 
-void update_thunder(Uint32 current_time) {
+void update_thunder(const FrameTime* ft) {
+    Uint32 current_time = ft->ms;
+    
     // 更新雷声状态
     if (thunder_active && current_time >= thunder_start_time) {
         if (current_time - thunder_start_time > thunder_duration) {
@@ -1240,252 +4302,1172 @@ void update_thunder(Uint32 current_time) {
     }
 }
 
-// 检查雨滴与荷叶的碰撞
-bool check_raindrop_lotus_collision(Raindrop* raindrop) {
-    // 检查雨滴与荷叶的碰撞
-    float proj_x = project_x(raindrop->x, raindrop->z);
+// 根据z坐标计算所在的z段
+static int collision_z_band(float z) {
+    int band = (int)(z / COLLISION_Z_RANGE);
+    if (band < 0) band = 0;
+    if (band >= COLLISION_Z_BANDS) band = COLLISION_Z_BANDS - 1;
+    return band;
+}
+
+// 把屏幕坐标换算成网格行列（越界的物体和雨滴归入边缘单元，仍会做精确测试）
+static int collision_col(float x) {
+    int col = (int)floorf(x / COLLISION_CELL_SIZE);
+    if (col < 0) col = 0;
+    if (col >= COLLISION_GRID_COLS) col = COLLISION_GRID_COLS - 1;
+    return col;
+}
+
+static int collision_row(float y) {
+    int row = (int)floorf(y / COLLISION_CELL_SIZE);
+    if (row < 0) row = 0;
+    if (row >= COLLISION_GRID_ROWS) row = COLLISION_GRID_ROWS - 1;
+    return row;
+}
+
+static int collision_cell(int band, int row, int col) {
+    return (band * COLLISION_GRID_ROWS + row) * COLLISION_GRID_COLS + col;
+}
+
+static void add_collider(ColliderType type, int index, float x, float y, float z,
+                         float radius, float half_w, float half_h) {
+    if (collision_grid.collider_count >= collision_grid.collider_capacity) return;
+    Collider* c = &collision_grid.colliders[collision_grid.collider_count++];
+    c->type = type;
+    c->index = index;
+    c->x = x;
+    c->y = y;
+    c->z = z;
+    c->radius = radius;
+    c->half_w = half_w;
+    c->half_h = half_h;
+}
+
+// 重建碰撞网格：收集荷叶、荷花、芦苇的屏幕空间包围形状，再用计数排序放入单元
+void build_collision_grid(Uint32 current_time) {
+    float time_seconds = current_time / 1000.0f;
+    collision_grid.collider_count = 0;
+    
+    for (int i = 0; i < lotus_pad_count; i++) {
+        // 考虑荷叶倾斜时的椭圆形状
+        float tilt_factor = 1.0f + fabsf(lotus_pads[i].tilt_angle) * 0.5f;
+        add_collider(COLLIDER_LOTUS_PAD, i,
+                     project_x(lotus_pads[i].x, lotus_pads[i].z), lotus_pads[i].y, lotus_pads[i].z,
+                     lotus_pads[i].radius / tilt_factor, 0.0f, 0.0f);
+    }
+    for (int i = 0; i < LOTUS_FLOWER_COUNT; i++) {
+        add_collider(COLLIDER_LOTUS_FLOWER, i,
+                     project_x(lotus_flowers[i].x, lotus_flowers[i].z), lotus_flowers[i].y, lotus_flowers[i].z,
+                     lotus_flowers[i].size, 0.0f, 0.0f);
+    }
+    for (int i = 0; i < REED_COUNT; i++) {
+        // 与render()中的芦苇姿态一致：茎随风摇摆，叶子在茎顶端
+        float sway_angle = table_sinf(time_seconds * reeds[i].sway_speed + reeds[i].sway_offset) * 
+                           (0.1f + fabsf(wind_strength) * 0.5f);
+        float base_x = project_x(reeds[i].x, reeds[i].z);
+        float stem_height = reeds[i].height * 0.7f;
+        float top_x = base_x + stem_height * fast_sinf(sway_angle);
+        float top_y = reeds[i].y - stem_height - reeds[i].height * 0.5f;
+        add_collider(COLLIDER_REED, i,
+                     (base_x + top_x) * 0.5f, (reeds[i].y + top_y) * 0.5f, reeds[i].z,
+                     0.0f, fabsf(top_x - base_x) * 0.5f + 1.0f, (reeds[i].y - top_y) * 0.5f);
+    }
     
-    for (int i = 0; i < LOTUS_PAD_COUNT; i++) {
-        // 简单的圆形碰撞检测
-        float pad_proj_x = project_x(lotus_pads[i].x, lotus_pads[i].z);
+    // 计数排序第一遍：统计每个单元的碰撞体数量
+    memset(collision_grid.cell_start, 0, sizeof(int) * (COLLISION_GRID_CELLS + 1));
+    collision_grid.min_y = (float)window_height;
+    int total_refs = 0;
+    for (int k = 0; k < collision_grid.collider_count; k++) {
+        Collider* c = &collision_grid.colliders[k];
+        float ext_x = c->type == COLLIDER_REED ? c->half_w : c->radius;
+        float ext_y = c->type == COLLIDER_REED ? c->half_h : c->radius;
+        if (c->y - ext_y < collision_grid.min_y) collision_grid.min_y = c->y - ext_y;
         
-        // 雨滴深度应该接近荷叶深度才有效果
-        if (fabsf(raindrop->z - lotus_pads[i].z) < 0.2f) {
-            float dx = proj_x - pad_proj_x;
-            float dy = raindrop->y - lotus_pads[i].y;
-            float distance = sqrtf(dx*dx + dy*dy);
-            
-            // 考虑荷叶倾斜时的椭圆形状
-            float tilt_factor = 1.0f + fabsf(lotus_pads[i].tilt_angle) * 0.5f;
-            float scaled_radius = lotus_pads[i].radius / tilt_factor;
-            
-            if (distance < scaled_radius) {
-                return true;
+        int band = collision_z_band(c->z);
+        int col0 = collision_col(c->x - ext_x), col1 = collision_col(c->x + ext_x);
+        int row0 = collision_row(c->y - ext_y), row1 = collision_row(c->y + ext_y);
+        if (total_refs + (col1 - col0 + 1) * (row1 - row0 + 1) > collision_grid.ref_capacity) {
+            // 引用数超出容量时丢弃该碰撞体（正常尺寸的物体不会触发）
+            collision_grid.colliders[k] = collision_grid.colliders[--collision_grid.collider_count];
+            k--;
+            continue;
+        }
+        for (int row = row0; row <= row1; row++) {
+            for (int col = col0; col <= col1; col++) {
+                collision_grid.cell_start[collision_cell(band, row, col) + 1]++;
+                total_refs++;
             }
         }
     }
+    for (int c = 0; c < COLLISION_GRID_CELLS; c++) {
+        collision_grid.cell_start[c + 1] += collision_grid.cell_start[c];
+    }
     
-    return false;
+    // 第二遍：写入碰撞体下标
+    int* fill = collision_grid.cell_fill;
+    memcpy(fill, collision_grid.cell_start, sizeof(int) * COLLISION_GRID_CELLS);
+    for (int k = 0; k < collision_grid.collider_count; k++) {
+        Collider* c = &collision_grid.colliders[k];
+        float ext_x = c->type == COLLIDER_REED ? c->half_w : c->radius;
+        float ext_y = c->type == COLLIDER_REED ? c->half_h : c->radius;
+        int band = collision_z_band(c->z);
+        int col0 = collision_col(c->x - ext_x), col1 = collision_col(c->x + ext_x);
+        int row0 = collision_row(c->y - ext_y), row1 = collision_row(c->y + ext_y);
+        for (int row = row0; row <= row1; row++) {
+            for (int col = col0; col <= col1; col++) {
+                collision_grid.cell_items[fill[collision_cell(band, row, col)]++] = k;
+            }
+        }
+    }
+    
+    collision_grid.camera_x = camera_x;
+    collision_grid.dirty = false;
 }
 
-void update_raindrops(Uint32 current_time, float delta_time) {
-    for (int i = 0; i < MAX_RAINDROPS; i++) {
-        if (raindrops[i].active) {
-            if (!raindrops[i].in_water) {
-                // 风力影响 - 只影响下落中的雨滴
-                float wind_effect = wind_strength * 100.0f * delta_time;
-                
-                // 在暴风雨中，单个雨滴受到的风力有一定随机性，创造更动态的效果
-                if (current_weather >= WEATHER_HEAVY_RAIN) {
-                    wind_effect += (((float)rand() / RAND_MAX) * 2.0f - 1.0f) * 20.0f * delta_time * 
-                                  (0.5f + weather_intensity / 100.0f);
-                }
-                
-                // 更新雨滴水平位置（受风影响）
-                raindrops[i].x += raindrops[i].speed_x * delta_time + wind_effect;
-                
-                // 更新雨滴垂直位置
-                raindrops[i].y += raindrops[i].speed_y * delta_time;
-                
-                // 检查雨滴是否击中荷叶
-                if (raindrop_count % 5 == 0 && check_raindrop_lotus_collision(&raindrops[i])) {
-                    raindrops[i].in_water = true;
-                    raindrops[i].water_time = current_time;
+// 线段 P0 + t*D (t∈[0,1]) 与圆的最早交点
+static bool sweep_circle(float x0, float y0, float dx, float dy,
+                         float cx, float cy, float radius, float* t_hit) {
+    float fx = x0 - cx;
+    float fy = y0 - cy;
+    float c = fx*fx + fy*fy - radius*radius;
+    if (c < 0.0f) {
+        // 起点已在圆内
+        *t_hit = 0.0f;
+        return true;
+    }
+    float a = dx*dx + dy*dy;
+    float b = fx*dx + fy*dy;
+    if (a <= 0.0f || b >= 0.0f) return false;  // 静止或远离圆心
+    float disc = b*b - a*c;
+    if (disc < 0.0f) return false;
+    float t = (-b - sqrtf(disc)) / a;
+    if (t > 1.0f) return false;
+    *t_hit = t;
+    return true;
+}
+
+// 线段 P0 + t*D (t∈[0,1]) 与轴对齐矩形的最早交点（slab法）
+static bool sweep_box(float x0, float y0, float dx, float dy,
+                      float cx, float cy, float half_w, float half_h, float* t_hit) {
+    float t_min = 0.0f, t_max = 1.0f;
+    float p[2] = {x0 - cx, y0 - cy};
+    float d[2] = {dx, dy};
+    float h[2] = {half_w, half_h};
+    for (int axis = 0; axis < 2; axis++) {
+        if (fabsf(d[axis]) < 1e-6f) {
+            if (p[axis] < -h[axis] || p[axis] > h[axis]) return false;
+        } else {
+            float t0 = (-h[axis] - p[axis]) / d[axis];
+            float t1 = (h[axis] - p[axis]) / d[axis];
+            if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; }
+            if (t0 > t_min) t_min = t0;
+            if (t1 < t_max) t_max = t1;
+            if (t_min > t_max) return false;
+        }
+    }
+    *t_hit = t_min;
+    return true;
+}
+
+// 检查雨滴本帧的位移线段是否击中荷叶、荷花或芦苇（连续检测，低帧率下也不会穿透）
+bool check_raindrop_collision(int index, CollisionHit* hit) {
+    float z = raindrops.z[index];
+    float x0 = project_x(raindrops.prev_x[index], z);
+    float y0 = raindrops.prev_y[index];
+    float x1 = project_x(raindrops.x[index], z);
+    float y1 = raindrops.y[index];
+    
+    // 雨滴还在所有物体上方时无需查询
+    if (fmaxf(y0, y1) < collision_grid.min_y) return false;
+    
+    int col0 = collision_col(fminf(x0, x1)), col1 = collision_col(fmaxf(x0, x1));
+    int row0 = collision_row(fminf(y0, y1)), row1 = collision_row(fmaxf(y0, y1));
+    int band = collision_z_band(z);
+    int band0 = band > 0 ? band - 1 : 0;
+    int band1 = band < COLLISION_Z_BANDS - 1 ? band + 1 : band;
+    
+    float best_t = 2.0f;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    for (int b = band0; b <= band1; b++) {
+        for (int row = row0; row <= row1; row++) {
+            for (int col = col0; col <= col1; col++) {
+                int cell = collision_cell(b, row, col);
+                for (int k = collision_grid.cell_start[cell]; k < collision_grid.cell_start[cell + 1]; k++) {
+                    const Collider* c = &collision_grid.colliders[collision_grid.cell_items[k]];
                     
-                    // 在荷叶上创建溅射效果
-                    create_splash(raindrops[i].x, raindrops[i].y, raindrops[i].z, raindrops[i].color);
-                }
-                // 检查雨滴是否击中水面
-                else if (raindrops[i].y >= POND_HEIGHT) {
-                    raindrops[i].in_water = true;
-                    raindrops[i].water_time = current_time;
+                    // 雨滴深度应该接近物体深度才有效果
+                    if (fabsf(z - c->z) >= COLLISION_Z_RANGE) continue;
                     
-                    // 创建涟漪
-                    create_ripple(raindrops[i].x, POND_HEIGHT, raindrops[i].z, raindrops[i].color);
-                }
-            } else {
-                // 雨滴已入水
-                // 如果入水超过500毫秒，停用它
-                if (current_time - raindrops[i].water_time > 500) {
-                    raindrops[i].active = false;
-                    raindrop_count--;
+                    float t;
+                    bool hit_now = c->type == COLLIDER_REED ?
+                        sweep_box(x0, y0, dx, dy, c->x, c->y, c->half_w, c->half_h, &t) :
+                        sweep_circle(x0, y0, dx, dy, c->x, c->y, c->radius, &t);
+                    // 同一物体可能出现在多个单元中，重复测试只会得到相同的t
+                    if (hit_now && t < best_t) {
+                        best_t = t;
+                        hit->type = c->type;
+                        hit->index = c->index;
+                    }
                 }
             }
         }
     }
+    
+    if (best_t > 1.0f) return false;
+    hit->t = best_t;
+    return true;
 }
 
-void update_ripples(Uint32 current_time) {
-    for (int i = 0; i < MAX_RIPPLES; i++) {
-        if (ripples[i].active) {
-            // 计算涟漪已经存在的时间
-            Uint32 ripple_age = current_time - ripples[i].creation_time;
-            
-            // 根据年龄更新涟漪半径
-            float progress = (float)ripple_age / RIPPLE_LIFETIME;
-            if (progress > 1.0f) progress = 1.0f;
-            
-            ripples[i].radius = ripples[i].max_radius * progress;
-            
-            // 随时间淡出涟漪
-            ripples[i].color.a = (Uint8)(255 * (1.0f - progress));
+// 雨滴下落积分内核：x += speed_x*dt + 风力 + 扰动，y += speed_y*dt
+// 位移乘以 fall_mask，静止的雨滴保持不动，循环内没有分支；
+// 积分前的位置写入 prev_x/prev_y，供连续碰撞检测使用
+void integrate_raindrops(int begin, int end, float delta_time, float wind_effect,
+                         const float* jitter, float jitter_scale) {
+    float* xs = raindrops.x;
+    float* ys = raindrops.y;
+    float* pxs = raindrops.prev_x;
+    float* pys = raindrops.prev_y;
+    const float* sx = raindrops.speed_x;
+    const float* sy = raindrops.speed_y;
+    const float* mask = raindrops.fall_mask;
+    int i = begin;
+    
+#ifdef SIMD_AVX2
+    {
+        __m256 dt = _mm256_set1_ps(delta_time);
+        __m256 wind = _mm256_set1_ps(wind_effect);
+        __m256 js = _mm256_set1_ps(jitter_scale);
+        for (; i + 8 <= end; i += 8) {
+            __m256 m = _mm256_loadu_ps(mask + i);
+            __m256 dx = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(sx + i), dt), wind);
+            dx = _mm256_add_ps(dx, _mm256_mul_ps(_mm256_loadu_ps(jitter + i), js));
+            __m256 dy = _mm256_mul_ps(_mm256_loadu_ps(sy + i), dt);
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 y = _mm256_loadu_ps(ys + i);
+            _mm256_storeu_ps(pxs + i, x);
+            _mm256_storeu_ps(pys + i, y);
+            _mm256_storeu_ps(xs + i, _mm256_add_ps(x, _mm256_mul_ps(dx, m)));
+            _mm256_storeu_ps(ys + i, _mm256_add_ps(y, _mm256_mul_ps(dy, m)));
+        }
+    }
+#endif
+#ifdef SIMD_SSE2
+    {
+        __m128 dt = _mm_set1_ps(delta_time);
+        __m128 wind = _mm_set1_ps(wind_effect);
+        __m128 js = _mm_set1_ps(jitter_scale);
+        for (; i + 4 <= end; i += 4) {
+            __m128 m = _mm_loadu_ps(mask + i);
+            __m128 dx = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(sx + i), dt), wind);
+            dx = _mm_add_ps(dx, _mm_mul_ps(_mm_loadu_ps(jitter + i), js));
+            __m128 dy = _mm_mul_ps(_mm_loadu_ps(sy + i), dt);
+            __m128 x = _mm_loadu_ps(xs + i);
+            __m128 y = _mm_loadu_ps(ys + i);
+            _mm_storeu_ps(pxs + i, x);
+            _mm_storeu_ps(pys + i, y);
+            _mm_storeu_ps(xs + i, _mm_add_ps(x, _mm_mul_ps(dx, m)));
+            _mm_storeu_ps(ys + i, _mm_add_ps(y, _mm_mul_ps(dy, m)));
+        }
+    }
+#endif
+    // 标量路径（没有SIMD时处理全部雨滴，否则只处理尾部）
+    for (; i < end; i++) {
+        float dx = sx[i] * delta_time + wind_effect + jitter[i] * jitter_scale;
+        pxs[i] = xs[i];
+        pys[i] = ys[i];
+        xs[i] += dx * mask[i];
+        ys[i] += sy[i] * delta_time * mask[i];
+    }
+}
+
+// 雨滴并行更新的参数
+typedef struct {
+    Uint32 current_time;
+    float delta_time;
+    float wind_effect;
+    const float* jitter;
+    float jitter_scale;
+} RaindropStepParams;
+
+// 更新 [begin, end) 范围的雨滴：积分、碰撞、入水
+// 只写本范围内的雨滴，新涟漪/水珠和回收请求写入本线程的生成缓冲区
+static void update_raindrop_range(int begin, int end, int worker, void* userdata) {
+    const RaindropStepParams* p = userdata;
+    WorkerBuffer* buf = &worker_buffers[worker];
+    Uint32 current_time = p->current_time;
+    
+    // 第一遍：批量积分
+    integrate_raindrops(begin, end, p->delta_time, p->wind_effect, p->jitter, p->jitter_scale);
+    
+    // 第二遍：逐个处理碰撞、入水和回收
+    for (int i = begin; i < end; i++) {
+        if (!raindrops.in_water[i]) {
+            // 本帧位移穿过水面的位置（参数t），未到达水面时为2
+            float water_t = 2.0f;
+            if (raindrops.y[i] >= pond_height) {
+                float dy = raindrops.y[i] - raindrops.prev_y[i];
+                water_t = dy > 0.0f ? (pond_height - raindrops.prev_y[i]) / dy : 0.0f;
+                if (water_t < 0.0f) water_t = 0.0f;
+            }
             
-            // 如果涟漪达到其生命周期，停用它
-            if (ripple_age >= RIPPLE_LIFETIME) {
-                ripples[i].active = false;
-                ripple_count--;
+            // 检查雨滴是否先击中荷叶、荷花或芦苇
+            CollisionHit hit;
+            if (check_raindrop_collision(i, &hit) && hit.t <= water_t) {
+                // 把雨滴移到碰撞点
+                raindrops.x[i] = raindrops.prev_x[i] + (raindrops.x[i] - raindrops.prev_x[i]) * hit.t;
+                raindrops.y[i] = raindrops.prev_y[i] + (raindrops.y[i] - raindrops.prev_y[i]) * hit.t;
+                raindrops.in_water[i] = true;
+                raindrops.fall_mask[i] = 0.0f;
+                raindrops.water_time[i] = current_time;
+                
+                // 在物体上创建溅射效果
+                push_spawn_event(buf, i, SPAWN_SPLASH, raindrops.x[i], raindrops.y[i], raindrops.z[i], raindrops.color[i]);
+            }
+            // 检查雨滴是否击中水面
+            else if (raindrops.y[i] >= pond_height) {
+                raindrops.in_water[i] = true;
+                raindrops.fall_mask[i] = 0.0f;
+                raindrops.water_time[i] = current_time;
+                
+                // 创建涟漪
+                push_spawn_event(buf, i, SPAWN_RIPPLE, raindrops.x[i], pond_height, raindrops.z[i], raindrops.color[i]);
+            }
+        } else {
+            // 雨滴已入水
+            // 如果入水超过500毫秒，回收它
+            if (current_time - raindrops.water_time[i] > 500) {
+                push_removal(buf, i);
             }
         }
     }
 }
 
-void update_splashes(Uint32 current_time, float delta_time) {
-    for (int i = 0; i < MAX_SPLASHES; i++) {
-        if (splashes[i].active) {
-            // 计算已存在时间
-            Uint32 splash_age = current_time - splashes[i].creation_time;
-            
-            // 重力效果
-            splashes[i].speed_y += 500.0f * delta_time; // 重力加速度
-            
-            // 更新位置
-            splashes[i].x += splashes[i].speed_x * delta_time;
-            splashes[i].y += splashes[i].speed_y * delta_time;
+void update_raindrops(const FrameTime* ft) {
+    Uint32 current_time = ft->ms;
+    float delta_time = ft->delta_time;
+    RaindropStepParams params;
+    
+    params.current_time = current_time;
+    params.delta_time = delta_time;
+    
+    // 风力影响 - 只影响下落中的雨滴
+    params.wind_effect = wind_strength * 100.0f * delta_time;
+    
+    // 在暴风雨中，单个雨滴受到的风力有一定随机性，创造更动态的效果
+    params.jitter_scale = 0.0f;
+    if (current_weather >= WEATHER_HEAVY_RAIN) {
+        params.jitter_scale = 20.0f * delta_time * (0.5f + weather_intensity / 100.0f);
+    }
+    if (params.jitter_scale > 0.0f) {
+        rng_fill_floats(&rain_jitter_rng, rain_jitter, raindrop_count, -1.0f, 1.0f);
+    }
+    params.jitter = rain_jitter;
+    
+    // 荷叶或相机移动后重建碰撞网格（并行阶段只读）
+    if (collision_grid.dirty || collision_grid.camera_x != camera_x) {
+        build_collision_grid(current_time);
+    }
+    
+    clear_worker_buffers();
+    parallel_for(raindrop_count, PARALLEL_CHUNK_SIZE, update_raindrop_range, &params);
+    merge_worker_buffers(remove_raindrop, current_time);
+}
+
+static void update_ripple_range(int begin, int end, int worker, void* userdata) {
+    Uint32 current_time = *(const Uint32*)userdata;
+    WorkerBuffer* buf = &worker_buffers[worker];
+    
+    for (int i = begin; i < end; i++) {
+        // 计算涟漪已经存在的时间
+        Uint32 ripple_age = current_time - ripples[i].creation_time;
+        
+        // 如果涟漪达到其生命周期，回收它
+        if (ripple_age >= RIPPLE_LIFETIME) {
+            push_removal(buf, i);
+            continue;
+        }
+        
+        // 根据年龄更新涟漪半径
+        float progress = (float)ripple_age / RIPPLE_LIFETIME;
+        
+        ripples[i].radius = ripples[i].max_radius * progress;
+        
+        // 随时间淡出涟漪
+        ripples[i].color.a = (Uint8)(255 * (1.0f - progress));
+    }
+}
+
+void update_ripples(const FrameTime* ft) {
+    Uint32 current_time = ft->ms;
+    
+    clear_worker_buffers();
+    parallel_for(ripple_count, PARALLEL_CHUNK_SIZE, update_ripple_range, &current_time);
+    merge_worker_buffers(remove_ripple, current_time);
+}
+
+static void update_splash_range(int begin, int end, int worker, void* userdata) {
+    const FrameTime* ft = userdata;
+    Uint32 current_time = ft->ms;
+    float delta_time = ft->delta_time;
+    WorkerBuffer* buf = &worker_buffers[worker];
+    
+    for (int i = begin; i < end; i++) {
+        // 计算已存在时间
+        Uint32 splash_age = current_time - splashes[i].creation_time;
+        
+        // 随时间淡出，寿命结束则回收水珠
+        float progress = (float)splash_age / SPLASH_LIFETIME;
+        if (progress > 1.0f) {
+            push_removal(buf, i);
+            continue;
+        }
+        
+        // 重力效果
+        splashes[i].speed_y += 500.0f * delta_time; // 重力加速度
+        
+        // 更新位置（保留上一步位置用于渲染插值）
+        splashes[i].prev_x = splashes[i].x;
+        splashes[i].prev_y = splashes[i].y;
+        splashes[i].x += splashes[i].speed_x * delta_time;
+        splashes[i].y += splashes[i].speed_y * delta_time;
+        
+        // 如果水珠落入水面，创建小涟漪并回收
+        if (splashes[i].y >= pond_height && splashes[i].speed_y > 0) {
+            // 创建小涟漪
+            SDL_Color ripple_color = splashes[i].color;
+            ripple_color.a = (Uint8)(ripple_color.a * (1.0f - progress)); // 根据寿命调整透明度
+            push_spawn_event(buf, i, SPAWN_RIPPLE, splashes[i].x, pond_height, splashes[i].z, ripple_color);
+            push_removal(buf, i);
+        }
+    }
+}
+
+void update_splashes(const FrameTime* ft) {
+    clear_worker_buffers();
+    parallel_for(splash_count, PARALLEL_CHUNK_SIZE, update_splash_range, (void*)ft);
+    merge_worker_buffers(remove_splash, ft->ms);
+}
+
+void update_lightning(const FrameTime* ft) {
+    Uint32 current_time = ft->ms;
+    
+    for (int i = 0; i < MAX_LIGHTNING; i++) {
+        if (lightnings[i].active) {
+            // 计算闪电已存在的时间
+            Uint32 lightning_age = current_time - lightnings[i].creation_time;
             
-            // 随时间淡出
-            float progress = (float)splash_age / SPLASH_LIFETIME;
-            if (progress > 1.0f) {
-                // 停用水珠
-                splashes[i].active = false;
-                splash_count--;
+            // 如果闪电达到其生命周期，停用它
+            if (lightning_age >= lightnings[i].duration) {
+                lightnings[i].active = false;
+                lightning_count--;
             }
-            
-            // 如果水珠落入水面，创建小涟漪并停用
-            if (splashes[i].y >= POND_HEIGHT && splashes[i].speed_y > 0) {
-                // 创建小涟漪
-                SDL_Color ripple_color = splashes[i].color;
-                ripple_color.a = (Uint8)(ripple_color.a * (1.0f - progress)); // 根据寿命调整透明度
-                create_ripple(splashes[i].x, POND_HEIGHT, splashes[i].z, ripple_color);
-                
-                // 停用水珠
-                splashes[i].active = false;
-                splash_count--;
+        }
+    }
+}
+
+void update_lotus_pads(const FrameTime* ft) {
+    float time_seconds = ft->ms / 1000.0f;
+    float delta_time = ft->delta_time;
+    
+    for (int i = 0; i < lotus_pad_count; i++) {
+        // 荷叶随风轻微波动
+        lotus_pads[i].wave_phase += delta_time * lotus_pads[i].wave_speed;
+        
+        // 风对荷叶的倾斜影响
+        lotus_pads[i].tilt_angle = wind_strength * 0.2f + 
+                                  table_sinf(time_seconds * lotus_pads[i].wave_speed + lotus_pads[i].wave_phase) * 0.1f;
+    }
+    
+    // 荷叶倾斜改变了碰撞半径，下次雨滴更新前重建碰撞网格
+    collision_grid.dirty = true;
+}
+
+void update_lotus_flowers(const FrameTime* ft) {
+    float delta_time = ft->delta_time;
+    
+    for (int i = 0; i < LOTUS_FLOWER_COUNT; i++) {
+        // 荷花随风轻微摇摆
+        lotus_flowers[i].sway_phase += delta_time * 0.5f;
+    }
+}
+
+// 生成新雨滴，雷暴天气下随机产生闪电和雷声
+void update_spawning(const FrameTime* ft) {
+    Uint32 current_time = ft->ms;
+    
+    // 按生成间隔累计本步应生成的雨滴数，整数部分一次性批量生成，小数部分留到下一步
+    // 这样雨的密度只取决于天气强度，与帧率无关；池满时多出的雨滴直接放弃，不会积压
+    raindrop_interval = get_rain_interval(current_weather, weather_intensity);
+    rain_spawn_debt += ft->delta_time * 1000.0f / raindrop_interval * current_quality()->spawn;
+    int owed = (int)rain_spawn_debt;
+    if (owed > 0) {
+        create_raindrops(owed, current_time);
+        rain_spawn_debt -= owed;
+    }
+    // 在雷暴天气下，随机产生闪电
+    if ((current_weather == WEATHER_THUNDERSTORM || 
+         (current_weather == WEATHER_HEAVY_RAIN && weather_intensity > 70)) && 
+        current_time - last_lightning_time > (10000 - weather_intensity * 80)) {            
+        // 闪电出现概率随强度增加
+        if (rng_int(&spawn_rng, 100) < weather_intensity / 5) {
+            int x = window_width / 2 + rng_int(&spawn_rng, 400) - 200;
+            create_lightning(x, 0, 5 + rng_int(&spawn_rng, 10), 2 + rng_int(&spawn_rng, 3), 0, current_time);                
+            // 随机产生雷声
+            if (rng_int(&spawn_rng, 100) < 50) {
+                thunder_active = true;
+                thunder_start_time = current_time + 500 + rng_int(&spawn_rng, 1000); // 闪电后延迟出现雷声
+                thunder_duration = 1000 + rng_int(&spawn_rng, 2000);
+            }                
+            last_lightning_time = current_time;
+        }
+    }
+}
+
+static void update_camera_task(const FrameTime* ft) {
+    (void)ft;
+    update_camera();
+}
+
+// 构建每个模拟步的任务图
+// 依赖边只加在有数据往来的地方（写后读、读后写）；共用同一随机数流的阶段
+// 位于同一条链上，保证随机数消耗顺序固定
+void build_simulation_graph(TaskGraph* graph) {
+    init_task_graph(graph);
+    
+    int weather = add_task(graph, "weather", update_weather_and_wind);
+    int thunder = add_task(graph, "thunder", update_thunder);
+    int stars = add_task(graph, "stars", update_stars);
+    int flowers = add_task(graph, "flowers", update_lotus_flowers);
+    // 新雨滴的速度取决于天气和风；闪电生成会改写雷声状态
+    int spawn = add_task(graph, "spawn", update_spawning);
+    add_task_dependency(graph, spawn, weather);
+    add_task_dependency(graph, spawn, thunder);
+    int lightning = add_task(graph, "lightning", update_lightning);
+    add_task_dependency(graph, lightning, spawn);
+    // 雨滴产生涟漪和水珠，水珠又产生涟漪：粒子更新依次汇合
+    int drops = add_task(graph, "raindrops", update_raindrops);
+    add_task_dependency(graph, drops, spawn);
+    int ripples_task = add_task(graph, "ripples", update_ripples);
+    add_task_dependency(graph, ripples_task, drops);
+    int splashes_task = add_task(graph, "splashes", update_splashes);
+    add_task_dependency(graph, splashes_task, ripples_task);
+    // 雨滴碰撞读取荷叶倾斜和相机位置，它们要在雨滴之后更新；
+    // 涟漪和水珠汇合时记录落水声要按相机位置求声像，相机也要在水珠之后更新
+    int pads = add_task(graph, "pads", update_lotus_pads);
+    add_task_dependency(graph, pads, weather);
+    add_task_dependency(graph, pads, drops);
+    int camera = add_task(graph, "camera", update_camera_task);
+    add_task_dependency(graph, camera, drops);
+    add_task_dependency(graph, camera, splashes_task);
+    
+    (void)stars;
+    (void)flowers;
+    (void)lightning;
+    (void)pads;
+    (void)camera;
+}
+
+// 推进一个固定步长的模拟
+void simulate_step(const FrameTime* ft) {
+    run_task_graph(&sim_graph, ft);
+    
+    // 累计本帧各任务耗时和关键路径
+    perf.task_count = sim_graph.task_count;
+    for (int i = 0; i < sim_graph.task_count; i++) {
+        perf.task_names[i] = sim_graph.tasks[i].name;
+        perf.task_time[i] += task_time_ms(&sim_graph.tasks[i]);
+    }
+    perf.critical_path_time += task_graph_critical_path(&sim_graph);
+}
+
+// ==== 内部渲染分辨率 ====
+
+// 以线性过滤创建纹理：低分辨率的场景帧放大到输出时平滑过渡，其余纹理仍按最近邻采样
+static SDL_Texture* create_upscale_texture(SDL_Renderer* target_renderer, int access, int w, int h) {
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+    SDL_Texture* texture = SDL_CreateTexture(target_renderer, SDL_PIXELFORMAT_ARGB8888, access, w, h);
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    return texture;
+}
+
+// 不使用平铺光栅化时，降分辨率渲染先画到离屏目标；创建失败则按输出分辨率直接绘制
+bool init_scene_target() {
+    scene_target = create_upscale_texture(renderer, SDL_TEXTUREACCESS_TARGET, render_width, render_height);
+    if (scene_target == NULL) {
+        printf("警告：无法创建离屏渲染目标，按输出分辨率绘制。SDL错误: %s\n", SDL_GetError());
+        render_scale = 1.0f;
+        render_width = window_width;
+        render_height = window_height;
+        return false;
+    }
+    set_scene_render_target(NULL);
+    return true;
+}
+
+// 切换场景的渲染目标，target 为 NULL 时回到场景帧（降分辨率时为离屏目标）
+// SDL切换目标时会重置缩放，这里重新设为内部渲染比例，绘制代码始终使用场景坐标
+void set_scene_render_target(SDL_Texture* target) {
+    SDL_SetRenderTarget(renderer, target ? target : scene_target);
+    SDL_RenderSetScale(renderer, render_scale, render_scale);
+}
+
+// 画质调节器降低渲染比例时只使用离屏帧左上角的一部分，放大时只取这部分
+void present_scene_target() {
+    if (scene_target == NULL) return;
+    SDL_Rect frame = {0, 0, render_width, render_height};
+    SDL_SetRenderTarget(renderer, NULL);
+    SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+    SDL_RenderCopy(renderer, scene_target, &frame, NULL);
+}
+
+// 调整内部渲染比例：帧缓冲和背景层按启动时的比例分配，比例降低后只使用左上角
+// 直接绘制到输出时，第一次降低比例才创建离屏目标（此时比例为1，按输出分辨率分配），
+// 恢复到全分辨率后释放，重新直接绘制到输出，免去每帧的全屏复制
+void apply_render_scale(float scale) {
+    if (scale < 0.1f) scale = 0.1f;
+    if (scale == render_scale) return;
+    if (!soft_raster.active) {
+        if (scale < 1.0f && scene_target == NULL && !init_scene_target()) return;
+        if (scale >= 1.0f && scene_target != NULL) {
+            SDL_DestroyTexture(scene_target);
+            scene_target = NULL;
+        }
+    }
+    render_scale = scale;
+    render_width = (int)ceilf(window_width * scale);
+    render_height = (int)ceilf(window_height * scale);
+    if (soft_raster.active) {
+        soft_raster.scale = scale;
+        soft_raster.tiles_x = (render_width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+        soft_raster.tiles_y = (render_height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+        SDL_RenderSetScale(soft_raster.scene_renderer, scale, scale);
+    }
+    sky_layer.valid = false;
+    mountain_layer.valid = false;
+}
+
+// ==== 画质调节器 ====
+
+// 窗口模式默认以60帧为预算；无界面模式用于测量吞吐量和生成可复现的画面，需显式指定预算才调节
+void init_quality_governor() {
+    memset(&quality, 0, sizeof(quality));
+    quality.budget_ms = options.frame_budget >= 0.0f ? options.frame_budget :
+                        (options.headless ? 0.0 : 1000.0 / 60);
+    quality.enabled = quality.budget_ms > 0.0;
+    quality.up_frames = QUALITY_UP_FRAMES;
+    quality.cooldown = QUALITY_COOLDOWN_FRAMES;  // 前几帧有纹理上传等一次性开销，不据此调整
+    if (quality.enabled) {
+        printf("画质调节器：帧预算 %.1fms，共 %d 级。\n", quality.budget_ms, QUALITY_LEVELS);
+    }
+}
+
+static void set_quality_level(int level) {
+    QualityGovernor* g = &quality;
+    g->raised = level < g->level;
+    g->level = level;
+    g->changes++;
+    g->cooldown = QUALITY_COOLDOWN_FRAMES;
+    g->over_frames = 0;
+    g->under_frames = 0;
+    g->frames_since_change = 0;
+    apply_render_scale(options.render_scale * quality_levels[level].render_scale);
+    printf("画质调节：%s到第 %d 级（平均工作耗时 %.1fms，预算 %.1fms）\n",
+           g->raised ? "提高" : "降低", level, g->avg_work, g->budget_ms);
+}
+
+// 平均耗时连续超预算或单帧严重超时降一级；平均耗时长时间低于余量线才升一级，两条线之间保持不变
+void update_quality_governor(double work_ms) {
+    QualityGovernor* g = &quality;
+    if (!g->enabled) return;
+    g->level_frames[g->level]++;
+    g->frames_since_change++;
+    g->avg_work = g->avg_work * 0.8 + work_ms * 0.2;
+    if (g->cooldown > 0) {
+        g->cooldown--;
+        return;
+    }
+    // 升级后稳定运行了一个等待周期，恢复正常的升级等待时间
+    if (g->raised && g->frames_since_change == g->up_frames) {
+        g->up_frames = QUALITY_UP_FRAMES;
+    }
+    bool spike = work_ms > g->budget_ms * QUALITY_SPIKE;
+    g->over_frames = g->avg_work > g->budget_ms ? g->over_frames + 1 : 0;
+    g->under_frames = g->avg_work < g->budget_ms * QUALITY_HEADROOM ? g->under_frames + 1 : 0;
+    if ((spike || g->over_frames >= QUALITY_DOWN_FRAMES) && g->level < QUALITY_LEVELS - 1) {
+        // 升级后不久又超预算：下次升级前多等一倍时间，避免在两级之间来回切换
+        if (g->raised && g->frames_since_change < g->up_frames) {
+            g->up_frames = g->up_frames * 2 < QUALITY_UP_FRAMES_MAX ? g->up_frames * 2 : QUALITY_UP_FRAMES_MAX;
+        }
+        set_quality_level(g->level + 1);
+    } else if (g->under_frames >= g->up_frames && g->level > 0) {
+        set_quality_level(g->level - 1);
+    }
+}
+
+const QualitySettings* current_quality() {
+    return &quality_levels[quality.level];
+}
+
+void print_quality_summary() {
+    if (!quality.enabled) return;
+    printf("画质调节：预算 %.1fms，调整 %d 次，各级帧数", quality.budget_ms, quality.changes);
+    for (int i = 0; i < QUALITY_LEVELS; i++) {
+        printf(" %d:%d", i, quality.level_frames[i]);
+    }
+    printf("\n");
+}
+
+// ==== 平铺光栅化后端 ====
+
+// 创建内存场景帧（内部渲染分辨率）及其软件渲染器，并在输出渲染器上创建同尺寸的流式纹理
+bool init_soft_raster() {
+    SoftRaster* sr = &soft_raster;
+    memset(sr, 0, sizeof(*sr));
+    sr->scale = render_scale;
+    sr->surface = SDL_CreateRGBSurface(0, render_width, render_height, 32,
+        0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (sr->surface != NULL) {
+        sr->scene_renderer = SDL_CreateSoftwareRenderer(sr->surface);
+    }
+    if (sr->scene_renderer != NULL) {
+        // SDL绘制按场景坐标缩放到帧；整帧上传后由输出渲染器线性放大
+        SDL_RenderSetScale(sr->scene_renderer, sr->scale, sr->scale);
+        sr->frame_texture = create_upscale_texture(output_renderer, SDL_TEXTUREACCESS_STREAMING,
+                                                   render_width, render_height);
+    }
+    sr->tiles_x = (render_width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    sr->tiles_y = (render_height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    sr->tile_start = malloc(sizeof(int) * (sr->tiles_x * sr->tiles_y + 1));
+    if (sr->frame_texture == NULL || sr->tile_start == NULL) {
+        printf("警告：无法创建平铺光栅化帧缓冲，改用SDL绘制。SDL错误: %s\n", SDL_GetError());
+        shutdown_soft_raster();
+        return false;
+    }
+    SDL_SetTextureBlendMode(sr->frame_texture, SDL_BLENDMODE_NONE);
+    sr->active = true;
+    printf("平铺光栅化：%dx%d 个 %d 像素分块，%d 个线程。\n",
+           sr->tiles_x, sr->tiles_y, RASTER_TILE_SIZE, SDL_GetCPUCount());
+    return true;
+}
+
+void shutdown_soft_raster() {
+    SoftRaster* sr = &soft_raster;
+    if (sr->frame_texture) SDL_DestroyTexture(sr->frame_texture);
+    if (sr->scene_renderer) SDL_DestroyRenderer(sr->scene_renderer);
+    if (sr->surface) SDL_FreeSurface(sr->surface);
+    if (sr->ripple_atlas) SDL_FreeSurface(sr->ripple_atlas);
+    free(sr->cmds);
+    free(sr->tile_start);
+    free(sr->tile_items);
+    memset(sr, 0, sizeof(*sr));
+}
+
+// 在命令表末尾预留 n 个槽位，返回第一个槽位的下标；容量不足时扩容
+static int raster_reserve(int n) {
+    SoftRaster* sr = &soft_raster;
+    if (sr->cmd_count + n > sr->cmd_capacity) {
+        int capacity = sr->cmd_capacity > 0 ? sr->cmd_capacity : 1024;
+        while (capacity < sr->cmd_count + n) capacity *= 2;
+        RasterCmd* cmds = realloc(sr->cmds, sizeof(RasterCmd) * capacity);
+        if (!cmds) {
+            printf("警告：平铺光栅化命令表扩容失败\n");
+            return -1;
+        }
+        sr->cmds = cmds;
+        sr->cmd_capacity = capacity;
+    }
+    int first = sr->cmd_count;
+    sr->cmd_count += n;
+    return first;
+}
+
+static Uint32 raster_color(SDL_Color c) {
+    return ((Uint32)c.a << 24) | ((Uint32)c.r << 16) | ((Uint32)c.g << 8) | c.b;
+}
+
+// 包围盒与 clip 求交，结果为空时返回 false
+static bool raster_clip(SDL_Rect* bounds, const SDL_Rect* clip) {
+    int x0 = bounds->x > clip->x ? bounds->x : clip->x;
+    int y0 = bounds->y > clip->y ? bounds->y : clip->y;
+    int x1 = bounds->x + bounds->w < clip->x + clip->w ? bounds->x + bounds->w : clip->x + clip->w;
+    int y1 = bounds->y + bounds->h < clip->y + clip->h ? bounds->y + bounds->h : clip->y + clip->h;
+    bounds->x = x0;
+    bounds->y = y0;
+    bounds->w = x1 - x0;
+    bounds->h = y1 - y0;
+    return bounds->w > 0 && bounds->h > 0;
+}
+
+static void raster_sprite(RasterCmd* cmd, const SDL_Rect* src, const SDL_Rect* dest,
+                          SDL_Color color, const SDL_Rect* clip) {
+    cmd->type = RASTER_SPRITE;
+    cmd->color = raster_color(color);
+    cmd->bounds = *dest;
+    cmd->x0 = dest->x;
+    cmd->y0 = dest->y;
+    cmd->x1 = src->x;
+    cmd->y1 = src->y;
+    if (!raster_clip(&cmd->bounds, clip)) cmd->type = RASTER_SKIP;
+}
+
+// 场景坐标换算为帧像素坐标（四舍五入）
+static int raster_scaled(float v) {
+    return (int)floorf(v * soft_raster.scale + 0.5f);
+}
+
+// 圆和线段以场景坐标给出，记录时换算到帧像素
+static void raster_disc(RasterCmd* cmd, int cx, int cy, int radius, SDL_Color color) {
+    SDL_Rect screen = {0, 0, render_width, render_height};
+    cx = raster_scaled(cx);
+    cy = raster_scaled(cy);
+    radius = raster_scaled(radius);
+    cmd->type = RASTER_DISC;
+    cmd->color = raster_color(color);
+    cmd->bounds.x = cx - radius;
+    cmd->bounds.y = cy - radius;
+    cmd->bounds.w = radius * 2 + 1;
+    cmd->bounds.h = radius * 2 + 1;
+    cmd->x0 = cx;
+    cmd->y0 = cy;
+    cmd->x1 = radius;
+    cmd->y1 = 0;
+    if (radius < 0 || !raster_clip(&cmd->bounds, &screen)) cmd->type = RASTER_SKIP;
+}
+
+static void raster_line(RasterCmd* cmd, int x0, int y0, int x1, int y1, SDL_Color color) {
+    SDL_Rect screen = {0, 0, render_width, render_height};
+    x0 = raster_scaled(x0);
+    y0 = raster_scaled(y0);
+    x1 = raster_scaled(x1);
+    y1 = raster_scaled(y1);
+    cmd->type = RASTER_LINE;
+    cmd->color = raster_color(color);
+    cmd->bounds.x = x0 < x1 ? x0 : x1;
+    cmd->bounds.y = y0 < y1 ? y0 : y1;
+    cmd->bounds.w = abs(x1 - x0) + 1;
+    cmd->bounds.h = abs(y1 - y0) + 1;
+    cmd->x0 = x0;
+    cmd->y0 = y0;
+    cmd->x1 = x1;
+    cmd->y1 = y1;
+    if (!raster_clip(&cmd->bounds, &screen)) cmd->type = RASTER_SKIP;
+}
+
+// 精灵一行的混合：atlas 中是白色圆环，只用其透明度
+// a = 纹理透明度 * 调制透明度，dst = color * a + dst * (255 - a)，除以255时四舍五入
+static void blend_sprite_row(Uint32* dst, const Uint32* src, int n, Uint32 color) {
+    int mod_a = (int)(color >> 24);
+    int i = 0;
+#ifdef SIMD_AVX2
+    {
+        __m256i zero = _mm256_setzero_si256();
+        __m256i c = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)(color | 0xFF000000u)), zero);
+        __m256i ma = _mm256_set1_epi32(mod_a);
+        __m256i round = _mm256_set1_epi16(128);
+        __m256i full = _mm256_set1_epi16(255);
+        for (; i + 8 <= n; i += 8) {
+            __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+            __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+            __m256i a = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_srli_epi32(s, 24), ma), round);
+            a = _mm256_srli_epi16(_mm256_add_epi16(a, _mm256_srli_epi16(a, 8)), 8);
+            a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));     // 每个像素的 a 复制到两个16位通道
+            __m256i a_lo = _mm256_unpacklo_epi32(a, a);
+            __m256i a_hi = _mm256_unpackhi_epi32(a, a);
+            __m256i d_lo = _mm256_unpacklo_epi8(d, zero);
+            __m256i d_hi = _mm256_unpackhi_epi8(d, zero);
+            __m256i t_lo = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(c, a_lo),
+                           _mm256_mullo_epi16(d_lo, _mm256_sub_epi16(full, a_lo))), round);
+            __m256i t_hi = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(c, a_hi),
+                           _mm256_mullo_epi16(d_hi, _mm256_sub_epi16(full, a_hi))), round);
+            t_lo = _mm256_srli_epi16(_mm256_add_epi16(t_lo, _mm256_srli_epi16(t_lo, 8)), 8);
+            t_hi = _mm256_srli_epi16(_mm256_add_epi16(t_hi, _mm256_srli_epi16(t_hi, 8)), 8);
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(t_lo, t_hi));
+        }
+    }
+#endif
+#ifdef SIMD_SSE2
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i c = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color | 0xFF000000u)), zero);
+        __m128i ma = _mm_set1_epi32(mod_a);
+        __m128i round = _mm_set1_epi16(128);
+        __m128i full = _mm_set1_epi16(255);
+        for (; i + 4 <= n; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            __m128i a = _mm_add_epi16(_mm_mullo_epi16(_mm_srli_epi32(s, 24), ma), round);
+            a = _mm_srli_epi16(_mm_add_epi16(a, _mm_srli_epi16(a, 8)), 8);
+            a = _mm_or_si128(a, _mm_slli_epi32(a, 16));           // 每个像素的 a 复制到两个16位通道
+            __m128i a_lo = _mm_unpacklo_epi32(a, a);
+            __m128i a_hi = _mm_unpackhi_epi32(a, a);
+            __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+            __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+            __m128i t_lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(c, a_lo),
+                           _mm_mullo_epi16(d_lo, _mm_sub_epi16(full, a_lo))), round);
+            __m128i t_hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(c, a_hi),
+                           _mm_mullo_epi16(d_hi, _mm_sub_epi16(full, a_hi))), round);
+            t_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+            t_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(t_lo, t_hi));
+        }
+    }
+#endif
+    // 标量路径（没有SIMD时处理整行，否则只处理尾部）
+    Uint32 c = color | 0xFF000000u;
+    for (; i < n; i++) {
+        Uint32 a = (src[i] >> 24) * mod_a + 128;
+        a = (a + (a >> 8)) >> 8;
+        Uint32 out = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            Uint32 t = ((c >> shift) & 0xFF) * a + ((dst[i] >> shift) & 0xFF) * (255 - a) + 128;
+            out |= ((t + (t >> 8)) >> 8) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+// 在一个分块内执行一条命令；rect 为分块与命令包围盒的交集
+static void raster_cmd_in_tile(const RasterCmd* cmd, const SDL_Rect* rect, Uint32* pixels, int pitch) {
+    switch (cmd->type) {
+        case RASTER_SPRITE: {
+            const SDL_Surface* atlas = soft_raster.ripple_atlas;
+            int atlas_pitch = atlas->pitch / 4;
+            for (int y = rect->y; y < rect->y + rect->h; y++) {
+                const Uint32* src = (const Uint32*)atlas->pixels +
+                    (cmd->y1 + y - cmd->y0) * atlas_pitch + cmd->x1 + rect->x - cmd->x0;
+                blend_sprite_row(pixels + y * pitch + rect->x, src, rect->w, cmd->color);
+            }
+            break;
+        }
+        case RASTER_DISC: {
+            // 与逐点绘制相同：x*x + y*y <= r*r 的像素，每行是一段连续区间
+            int r = cmd->x1;
+            for (int y = rect->y; y < rect->y + rect->h; y++) {
+                int dy = y - cmd->y0;
+                int half = isqrt(r * r - dy * dy);
+                int x0 = cmd->x0 - half > rect->x ? cmd->x0 - half : rect->x;
+                int x1 = cmd->x0 + half < rect->x + rect->w - 1 ? cmd->x0 + half : rect->x + rect->w - 1;
+                fill_span(pixels + y * pitch, x0, x1, cmd->color);
+            }
+            break;
+        }
+        case RASTER_LINE: {
+            // Bresenham，包含两个端点，只写入分块内的像素
+            int x = cmd->x0, y = cmd->y0;
+            int dx = abs(cmd->x1 - x), sx = x < cmd->x1 ? 1 : -1;
+            int dy = -abs(cmd->y1 - y), sy = y < cmd->y1 ? 1 : -1;
+            int err = dx + dy;
+            for (;;) {
+                if (x >= rect->x && x < rect->x + rect->w && y >= rect->y && y < rect->y + rect->h) {
+                    pixels[y * pitch + x] = cmd->color;
+                }
+                if (x == cmd->x1 && y == cmd->y1) break;
+                int e2 = 2 * err;
+                if (e2 >= dy) { err += dy; x += sx; }
+                if (e2 <= dx) { err += dx; y += sy; }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// 并行光栅化：每个任务处理若干分块，分块内按记录顺序执行命令，结果与线程数无关
+static void raster_tiles_range(int begin, int end, int worker, void* userdata) {
+    (void)worker;
+    (void)userdata;
+    SoftRaster* sr = &soft_raster;
+    Uint32* pixels = (Uint32*)sr->surface->pixels;
+    int pitch = sr->surface->pitch / 4;
+    for (int tile = begin; tile < end; tile++) {
+        SDL_Rect tile_rect = {
+            (tile % sr->tiles_x) * RASTER_TILE_SIZE,
+            (tile / sr->tiles_x) * RASTER_TILE_SIZE,
+            RASTER_TILE_SIZE, RASTER_TILE_SIZE
+        };
+        for (int k = sr->tile_start[tile]; k < sr->tile_start[tile + 1]; k++) {
+            const RasterCmd* cmd = &sr->cmds[sr->tile_items[k]];
+            SDL_Rect rect = cmd->bounds;
+            if (raster_clip(&rect, &tile_rect)) {
+                raster_cmd_in_tile(cmd, &rect, pixels, pitch);
+            }
+        }
+    }
+}
+
+void raster_begin() {
+    soft_raster.cmd_count = 0;
+}
+
+// 把本帧记录的命令按包围盒分到各个分块（计数、前缀和、填充），再并行光栅化
+void raster_end() {
+    SoftRaster* sr = &soft_raster;
+    int tile_count = sr->tiles_x * sr->tiles_y;
+    memset(sr->tile_start, 0, sizeof(int) * (tile_count + 1));
+    for (int i = 0; i < sr->cmd_count; i++) {
+        const RasterCmd* cmd = &sr->cmds[i];
+        if (cmd->type == RASTER_SKIP) continue;
+        int tx0 = cmd->bounds.x / RASTER_TILE_SIZE, tx1 = (cmd->bounds.x + cmd->bounds.w - 1) / RASTER_TILE_SIZE;
+        int ty0 = cmd->bounds.y / RASTER_TILE_SIZE, ty1 = (cmd->bounds.y + cmd->bounds.h - 1) / RASTER_TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                sr->tile_start[ty * sr->tiles_x + tx + 1]++;
+            }
+        }
+    }
+    for (int t = 0; t < tile_count; t++) {
+        sr->tile_start[t + 1] += sr->tile_start[t];
+    }
+    int item_count = sr->tile_start[tile_count];
+    if (item_count > sr->item_capacity) {
+        int* items = realloc(sr->tile_items, sizeof(int) * item_count);
+        if (!items) {
+            printf("警告：平铺光栅化分块列表扩容失败\n");
+            return;
+        }
+        sr->tile_items = items;
+        sr->item_capacity = item_count;
+    }
+    // 填充时 tile_start[t] 暂作写入位置，结束后恢复为起点
+    for (int i = 0; i < sr->cmd_count; i++) {
+        const RasterCmd* cmd = &sr->cmds[i];
+        if (cmd->type == RASTER_SKIP) continue;
+        int tx0 = cmd->bounds.x / RASTER_TILE_SIZE, tx1 = (cmd->bounds.x + cmd->bounds.w - 1) / RASTER_TILE_SIZE;
+        int ty0 = cmd->bounds.y / RASTER_TILE_SIZE, ty1 = (cmd->bounds.y + cmd->bounds.h - 1) / RASTER_TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                sr->tile_items[sr->tile_start[ty * sr->tiles_x + tx]++] = i;
             }
         }
     }
+    for (int t = tile_count; t > 0; t--) {
+        sr->tile_start[t] = sr->tile_start[t - 1];
+    }
+    sr->tile_start[0] = 0;
+    
+    // 先让SDL执行之前排队的绘制（背景、荷叶等），再直接写像素
+    SDL_RenderFlush(renderer);
+    parallel_for_coarse(tile_count, 1, raster_tiles_range, NULL);
 }
 
-void update_lightning(Uint32 current_time) {
-    for (int i = 0; i < MAX_LIGHTNING; i++) {
-        if (lightnings[i].active) {
-            // 计算闪电已存在的时间
-            Uint32 lightning_age = current_time - lightnings[i].creation_time;
-            
-            // 如果闪电达到其生命周期，停用它
-            if (lightning_age >= lightnings[i].duration) {
-                lightnings[i].active = false;
-                lightning_count--;
-            }
-            /* play sound */
-            if(lightning_sound != NULL) {
-                Mix_PlayChannel(-1, lightning_sound, 0);
-            }
-        }
-    }
+// 把场景帧（当前内部渲染分辨率的部分）上传到流式纹理并绘制到输出渲染器
+void present_soft_raster() {
+    SoftRaster* sr = &soft_raster;
+    if (!sr->active) return;
+    SDL_Rect frame = {0, 0, render_width, render_height};
+    SDL_RenderFlush(renderer);
+    SDL_UpdateTexture(sr->frame_texture, &frame, sr->surface->pixels, sr->surface->pitch);
+    SDL_SetRenderDrawColor(output_renderer, 0, 0, 0, 255);
+    SDL_RenderClear(output_renderer);
+    SDL_RenderCopy(output_renderer, sr->frame_texture, &frame, NULL);
 }
 
-void update_lotus_pads(Uint32 current_time, float delta_time) {
-    float time_seconds = current_time / 1000.0f;
-    
-    for (int i = 0; i < LOTUS_PAD_COUNT; i++) {
-        // 荷叶随风轻微波动
-        lotus_pads[i].wave_phase += delta_time * lotus_pads[i].wave_speed;
-        
-        // 风对荷叶的倾斜影响
-        lotus_pads[i].tilt_angle = wind_strength * 0.2f + 
-                                  sinf(time_seconds * lotus_pads[i].wave_speed + lotus_pads[i].wave_phase) * 0.1f;
+// ==== 静态背景层 ====
+
+static bool create_background_layer(BackgroundLayer* layer, SDL_BlendMode blend) {
+    // 与场景帧同为内部渲染分辨率，合成时按场景坐标铺满水面以上
+    int height = (int)ceilf(pond_height * render_scale);
+    layer->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                       render_width, height);
+    layer->glow = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                    render_width, height);
+    if (!layer->texture || !layer->glow) {
+        destroy_background_layer(layer);
+        return false;
     }
+    SDL_SetTextureBlendMode(layer->texture, blend);
+    SDL_SetTextureBlendMode(layer->glow, SDL_BLENDMODE_ADD);
+    layer->valid = false;
+    return true;
 }
 
-void update_lotus_flowers(Uint32 current_time, float delta_time) {
-    float time_seconds = current_time / 1000.0f;
-    
-    for (int i = 0; i < LOTUS_FLOWER_COUNT; i++) {
-        // 荷花随风轻微摇摆
-        lotus_flowers[i].sway_phase += delta_time * 0.5f;
+void destroy_background_layer(BackgroundLayer* layer) {
+    if (layer->texture) SDL_DestroyTexture(layer->texture);
+    if (layer->glow) SDL_DestroyTexture(layer->glow);
+    layer->texture = NULL;
+    layer->glow = NULL;
+    layer->valid = false;
+}
+
+// 星空层不透明（包含夜空底色），远山层透明；渲染器不支持渲染目标时每帧直接绘制
+void initialize_background_layers() {
+    if (!create_background_layer(&sky_layer, SDL_BLENDMODE_NONE) ||
+        !create_background_layer(&mountain_layer, SDL_BLENDMODE_BLEND)) {
+        printf("警告：无法创建背景层渲染目标，星空和远山将逐帧绘制。SDL错误: %s\n", SDL_GetError());
+        destroy_background_layer(&sky_layer);
+        destroy_background_layer(&mountain_layer);
     }
 }
 
-void render() {
-    // 绘制夜空背景（已在主循环中完成）
-    
-    // 是否有闪电照亮整个场景
-    bool lightning_flash = false;
-    Uint8 flash_brightness = 0;
-    
-    // 检查是否有活跃的闪电
-    for (int i = 0; i < MAX_LIGHTNING; i++) {
-        if (lightnings[i].active && lightnings[i].type == 0) {
-            lightning_flash = true;
-            flash_brightness = (Uint8)(lightnings[i].brightness * 0.4f);
-            break;
-        }
+// 层的输入（天气、强度、摄像机位置、刷新节拍）与上次绘制时不同则需要重绘，并记下新的输入
+static bool background_layer_stale(BackgroundLayer* layer, Uint32 tick) {
+    if (layer->valid && layer->camera_x == camera_x && layer->weather == current_weather &&
+        layer->intensity == weather_intensity && layer->tick == tick) {
+        return false;
     }
-    
-    // 如果有闪电，覆盖整个屏幕的半透明白色矩形
-    if (lightning_flash) {
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-        SDL_SetRenderDrawColor(renderer, flash_brightness, flash_brightness, flash_brightness, 100);
-        SDL_Rect flash_rect = {0, 0, WINDOW_WIDTH, WINDOW_HEIGHT};
-        SDL_RenderFillRect(renderer, &flash_rect);
-        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    layer->valid = true;
+    layer->camera_x = camera_x;
+    layer->weather = current_weather;
+    layer->intensity = weather_intensity;
+    layer->tick = tick;
+    return true;
+}
+
+// 切换到层纹理并用指定颜色清空，绘制完成后调用 set_scene_render_target(NULL)
+static void begin_background_layer(SDL_Texture* target, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    set_scene_render_target(target);
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+    SDL_RenderClear(renderer);
+}
+
+// 暴风雨时星星会被雨云遮挡，变暗
+static float star_visibility() {
+    float weather_visibility = 1.0f;
+    if (current_weather == WEATHER_THUNDERSTORM) {
+        weather_visibility = 0.2f; // 雷暴时星星只有20%亮度
+    } else if (current_weather == WEATHER_HEAVY_RAIN) {
+        weather_visibility = 0.4f; // 暴风雨时星星只有40%亮度
+    } else if (current_weather == WEATHER_MEDIUM_RAIN) {
+        weather_visibility = 0.7f; // 中雨时星星只有70%亮度
     }
     
-    // 绘制星星
-    for (int i = 0; i < STARS_COUNT; i++) {
+    // 天气强度进一步影响可见度
+    return weather_visibility * (1.0f - weather_intensity / 200.0f);
+}
+
+// 绘制星星：亮度由深度、闪烁和可见度决定，再加上闪电亮度；mask 为真时一律画白色
+static void draw_stars(float weather_visibility, int flash_add, bool mask) {
+    for (int i = 0; i < stars_count; i++) {
         // 计算投影位置
         int proj_x = (int)project_x(stars[i].x, stars[i].z);
         
         // 只绘制在屏幕内的星星
-        if (proj_x >= 0 && proj_x < WINDOW_WIDTH) {
-            // 暴风雨时星星会被雨云遮挡，变暗
-            float weather_visibility = 1.0f;
-            if (current_weather == WEATHER_THUNDERSTORM) {
-                weather_visibility = 0.2f; // 雷暴时星星只有20%亮度
-            } else if (current_weather == WEATHER_HEAVY_RAIN) {
-                weather_visibility = 0.4f; // 暴风雨时星星只有40%亮度
-            } else if (current_weather == WEATHER_MEDIUM_RAIN) {
-                weather_visibility = 0.7f; // 中雨时星星只有70%亮度
-            }
-            
-            // 天气强度进一步影响可见度
-            weather_visibility *= (1.0f - weather_intensity / 200.0f);
-            
-            // 计算星星的实际亮度（0-255）
-            float z_brightness_scale = get_z_scale(stars[i].z);
-            Uint8 brightness = (Uint8)(stars[i].brightness * 255 * z_brightness_scale * weather_visibility);
-            
-            // 闪电会增加星星亮度
-            if (lightning_flash) {
-                brightness = (Uint8)fminf(255, brightness + flash_brightness);
-            }
-            
-            SDL_SetRenderDrawColor(renderer, brightness, brightness, brightness, 255);
-            
-            // 绘制星星（小点）
-            SDL_RenderDrawPoint(renderer, proj_x, stars[i].y);
-            
-            // 对于特别亮的且较近的星星，绘制更大的点
-            if (stars[i].brightness > 0.8f && stars[i].z > 0.7f) {
-                SDL_RenderDrawPoint(renderer, proj_x + 1, stars[i].y);
-                SDL_RenderDrawPoint(renderer, proj_x - 1, stars[i].y);
-                SDL_RenderDrawPoint(renderer, proj_x, stars[i].y + 1);
-                SDL_RenderDrawPoint(renderer, proj_x, stars[i].y - 1);
-            }
+        if (proj_x < 0 || proj_x >= window_width) continue;
+        
+        // 计算星星的实际亮度（0-255）
+        float z_brightness_scale = get_z_scale(stars[i].z);
+        Uint8 brightness = (Uint8)(stars[i].brightness * 255 * z_brightness_scale * weather_visibility);
+        brightness = mask ? 255 : (Uint8)fminf(255, brightness + flash_add);
+        
+        SDL_SetRenderDrawColor(renderer, brightness, brightness, brightness, 255);
+        
+        // 绘制星星（小点）
+        SDL_RenderDrawPoint(renderer, proj_x, stars[i].y);
+        
+        // 对于特别亮的且较近的星星，绘制更大的点
+        if (stars[i].brightness > 0.8f && stars[i].z > 0.7f) {
+            SDL_RenderDrawPoint(renderer, proj_x + 1, stars[i].y);
+            SDL_RenderDrawPoint(renderer, proj_x - 1, stars[i].y);
+            SDL_RenderDrawPoint(renderer, proj_x, stars[i].y + 1);
+            SDL_RenderDrawPoint(renderer, proj_x, stars[i].y - 1);
         }
     }
-    
-    // 绘制月亮 - 根据天气状态调整可见度
+}
+
+// 月亮亮度根据天气状态调整
+static Uint8 moon_brightness() {
     float moon_visibility = 1.0f;
     switch (current_weather) {
         case WEATHER_LIGHT_RAIN:
@@ -1504,22 +5486,16 @@ void render() {
     
     // 天气强度进一步影响可见度
     moon_visibility *= (1.0f - weather_intensity / 200.0f);
-    
-    int moon_x = WINDOW_WIDTH * 3 / 4;
-    int moon_y = POND_HEIGHT / 4;
-    int moon_radius = 40;
+    return (Uint8)(230 * moon_visibility);
+}
+
+static void draw_moon(Uint8 brightness) {
+    int moon_x = window_width * 3 / 4;
+    int moon_y = pond_height / 4;
     
     // 应用摄像机偏移到月亮位置，但效果较小以模拟远距离
     int projected_moon_x = (int)project_x(moon_x, 0.1f);
     
-    // 月亮主体
-    Uint8 moon_brightness = (Uint8)(230 * moon_visibility);
-
-    // 闪电会增加月亮亮度
-    if (lightning_flash) {
-        moon_brightness = (Uint8)fminf(255, moon_brightness + flash_brightness);
-    }
-    
     SDL_Rect moon_rect = {
         projected_moon_x - 40,
         moon_y -40,
@@ -1529,36 +5505,263 @@ void render() {
     /* draw the texture */
     SDL_SetTextureColorMod(
         moon_texture,
-        moon_brightness,
-        moon_brightness,
-        (Uint8)(moon_brightness * 0.9f)
+        brightness,
+        brightness,
+        (Uint8)(brightness * 0.9f)
     );
     SDL_RenderCopy(renderer, moon_texture, NULL, &moon_rect);
+}
+
+// 绘制远山：山体纹理以山顶为中心对齐；mask 为真时画白色剪影
+// flash 不为0时每座山以加色混合再绘制一次，颜色调制取闪电亮度
+static void draw_mountains(bool mask, Uint8 flash) {
+    for (int i = 0; i < MOUNTAIN_COUNT; i++) {
+        if (!mountains[i].texture) continue;
+        
+        // 计算投影后的山位置
+        int mountain_proj_x = (int)project_x(mountains[i].x_offset, mountains[i].z);
+        int peak_x = mountain_proj_x + window_width / 2;
+        int peak_y = pond_height - mountains[i].height;
+        SDL_Rect dest = {peak_x - mountains[i].width / 2, peak_y, mountains[i].width / 2 * 2 + 1, mountains[i].height + 1};
+        if (mask) {
+            SDL_SetTextureColorMod(mountains[i].texture, 255, 255, 255);
+            SDL_RenderCopy(renderer, mountains[i].texture, NULL, &dest);
+            SDL_SetTextureColorMod(mountains[i].texture, mountains[i].color.r, mountains[i].color.g, mountains[i].color.b);
+        } else {
+            SDL_RenderCopy(renderer, mountains[i].texture, NULL, &dest);
+        }
+        
+        if (flash > 0) {
+            SDL_SetTextureBlendMode(mountains[i].texture, SDL_BLENDMODE_ADD);
+            SDL_SetTextureColorMod(mountains[i].texture, flash, flash, flash);
+            SDL_RenderCopy(renderer, mountains[i].texture, NULL, &dest);
+            SDL_SetTextureColorMod(mountains[i].texture, mountains[i].color.r, mountains[i].color.g, mountains[i].color.b);
+            SDL_SetTextureBlendMode(mountains[i].texture, SDL_BLENDMODE_BLEND);
+        }
+    }
+}
+
+// 层纹理中当前内部渲染比例实际用到的部分（画质调节器降低比例后小于纹理）
+static SDL_Rect background_layer_src() {
+    SDL_Rect src = {0, 0, render_width, (int)ceilf(pond_height * render_scale)};
+    return src;
+}
+
+// 闪电效果：以加色混合叠加层的白色蒙版，颜色调制取闪电亮度
+static void flash_background_layer(const BackgroundLayer* layer, Uint8 flash_brightness) {
+    SDL_Rect layer_rect = {0, 0, window_width, pond_height};
+    SDL_Rect src = background_layer_src();
+    SDL_SetTextureColorMod(layer->glow, flash_brightness, flash_brightness, flash_brightness);
+    SDL_RenderCopy(renderer, layer->glow, &src, &layer_rect);
+}
+
+// 闪电照亮粒子：各颜色通道加上 add，不超过255
+static SDL_Color flash_color(SDL_Color color, int add) {
+    color.r = (Uint8)fminf(255, color.r + add);
+    color.g = (Uint8)fminf(255, color.g + add);
+    color.b = (Uint8)fminf(255, color.b + add);
+    return color;
+}
+
+// 第 i 个涟漪在图集中的精灵、屏幕位置和颜色；不在屏幕上时返回 false
+// scale 把半径和位置换算到目标像素：平铺光栅化按1:1拷贝精灵，SDL绘制时由渲染器缩放，传1
+static bool ripple_sprite(int i, const FrameTime* ft, int flash_add, float scale,
+                          SDL_Color* color, const SDL_Rect** src, SDL_Rect* dest) {
+    // 计算投影坐标
+    int proj_x = (int)project_x(ripples[i].x, ripples[i].z);
+    
+    // 按插值后的渲染时刻计算半径
+    float progress = (float)(Sint32)(ft->render_ms - ripples[i].creation_time) / RIPPLE_LIFETIME;
+    if (progress < 0.0f) progress = 0.0f;
+    if (progress > 1.0f) progress = 1.0f;
+    float ripple_radius = ripples[i].max_radius * progress;
+    
+    // 如果涟漪不在屏幕上
+    if (proj_x + (int)ripple_radius < 0 || proj_x - (int)ripple_radius >= window_width) {
+        return false;
+    }
+    
+    // 根据深度调整颜色，闪电可能会影响涟漪颜色
+    *color = flash_color(adjust_color_by_depth(ripples[i].color, ripples[i].z), flash_add);
+    
+    // 根据深度计算实际半径
+    float z_scale = get_z_scale(ripples[i].z);
+    int radius = (int)(ripple_radius * z_scale * scale);
+    if (radius > RIPPLE_SPRITE_MAX_RADIUS) radius = RIPPLE_SPRITE_MAX_RADIUS;
+    
+    // 椭圆压缩系数 - 根据y位置不同而变化，实现透视效果，量化到图集的级数
+    float y_perspective = (ripples[i].y - pond_height) / (window_height - pond_height);
+    int step = (int)(y_perspective * (RIPPLE_SPRITE_ELLIPSE_STEPS - 1) + 0.5f);
+    if (step < 0) step = 0;
+    if (step >= RIPPLE_SPRITE_ELLIPSE_STEPS) step = RIPPLE_SPRITE_ELLIPSE_STEPS - 1;
+    
+    *src = &ripple_sprites[step][radius];
+    dest->x = (int)floorf(proj_x * scale + 0.5f) - ripple_sprite_half_width(radius);
+    dest->y = (int)(ripples[i].y * scale) - ripple_sprite_half_height(radius, ripple_sprite_ellipse(step));
+    dest->w = (*src)->w;
+    dest->h = (*src)->h;
+    return true;
+}
+
+// 第 i 个水珠的圆心、半径和颜色；不在屏幕上时返回 false
+static bool splash_disc(int i, const FrameTime* ft, int flash_add,
+                        SDL_Color* color, int* cx, int* cy, int* size) {
+    // 在上一步与当前步之间插值位置
+    float splash_x = splashes[i].prev_x + (splashes[i].x - splashes[i].prev_x) * ft->alpha;
+    float splash_y = splashes[i].prev_y + (splashes[i].y - splashes[i].prev_y) * ft->alpha;
+    
+    // 计算投影坐标
+    int proj_x = (int)project_x(splash_x, splashes[i].z);
+    
+    // 只绘制在屏幕内的水珠
+    if (proj_x < 0 || proj_x >= window_width || splash_y < 0 || splash_y >= window_height) {
+        return false;
+    }
+    
+    // 根据深度调整大小和颜色，闪电会影响水珠颜色
+    *size = (int)(splashes[i].size * get_z_scale(splashes[i].z));
+    *color = flash_color(adjust_color_by_depth(splashes[i].color, splashes[i].z), flash_add);
+    *cx = proj_x;
+    *cy = (int)splash_y;
+    return true;
+}
+
+// 第 i 个雨滴的线段端点和颜色；已入水或不在屏幕上时返回 false
+static bool raindrop_line(int i, const FrameTime* ft, int flash_add,
+                          SDL_Color* color, int* start_x, int* start_y, int* end_x, int* end_y) {
+    if (raindrops.in_water[i]) return false;
+    
+    // 在上一步与当前步之间插值位置
+    float drop_x = raindrops.prev_x[i] + (raindrops.x[i] - raindrops.prev_x[i]) * ft->alpha;
+    float drop_y = raindrops.prev_y[i] + (raindrops.y[i] - raindrops.prev_y[i]) * ft->alpha;
+    
+    // 计算投影坐标
+    int proj_x = (int)project_x(drop_x, raindrops.z[i]);
+    
+    // 只绘制在屏幕内的雨滴
+    if (proj_x < 0 || proj_x >= window_width || drop_y < 0 || drop_y >= window_height) {
+        return false;
+    }
+    
+    // 根据深度调整颜色，闪电会增亮雨滴
+    *color = flash_color(adjust_color_by_depth(raindrops.color[i], raindrops.z[i]), flash_add);
+    
+    // 根据深度调整大小
+    float z_scale = get_z_scale(raindrops.z[i]);
+    int actual_size = (int)(raindrops.size[i] * z_scale);
+    
+    // 计算雨滴的倾斜角度 - 受风影响
+    float rain_angle = wind_strength * 0.7f; // -0.7 到 0.7 弧度
+    
+    // 雨滴长度受强度影响
+    int drop_length = actual_size * (1 + weather_intensity / 100);
+    
+    // 计算雨滴起点和终点 - 考虑风力倾斜
+    *end_x = proj_x;
+    *end_y = (int)drop_y;
+    *start_x = *end_x - (int)(drop_length * fast_sinf(rain_angle));
+    *start_y = *end_y - (int)(drop_length * fast_cosf(rain_angle));
+    return true;
+}
+
+typedef struct {
+    const FrameTime* ft;
+    int flash_add;
+    int first;            // 本批雨滴在命令表中的起始槽位
+} RaindropRasterJob;
+
+// 并行记录雨滴命令：第 i 个雨滴写入固定槽位，命令顺序与线程数无关
+static void record_raindrops_range(int begin, int end, int worker, void* userdata) {
+    (void)worker;
+    const RaindropRasterJob* job = (const RaindropRasterJob*)userdata;
+    for (int i = begin; i < end; i++) {
+        RasterCmd* cmd = &soft_raster.cmds[job->first + i];
+        SDL_Color color;
+        int x0, y0, x1, y1;
+        if (raindrop_line(i, job->ft, job->flash_add, &color, &x0, &y0, &x1, &y1)) {
+            raster_line(cmd, x0, y0, x1, y1, color);
+        } else {
+            cmd->type = RASTER_SKIP;
+        }
+    }
+}
+
+void render(const FrameTime* ft) {
+    // 绘制夜空背景（已在主循环中完成）
+    
+    // 是否有闪电照亮整个场景
+    bool lightning_flash = false;
+    Uint8 flash_brightness = 0;
+    
+    // 检查是否有活跃的闪电
+    for (int i = 0; i < MAX_LIGHTNING; i++) {
+        if (lightnings[i].active && lightnings[i].type == 0) {
+            lightning_flash = true;
+            flash_brightness = (Uint8)(lightnings[i].brightness * 0.4f);
+            break;
+        }
+    }
+    
+    // 星空和月亮：缓存层按天气、强度和摄像机位置失效，并随星星闪烁定时重绘
+    if (sky_layer.texture) {
+        if (background_layer_stale(&sky_layer, ft->render_ms / BACKGROUND_REFRESH_MS)) {
+            begin_background_layer(sky_layer.texture, 0, 0, 20, 255);  // 与主循环清屏颜色相同
+            draw_stars(star_visibility(), 0, false);
+            draw_moon(moon_brightness());
+            begin_background_layer(sky_layer.glow, 0, 0, 0, 0);
+            draw_stars(0.0f, 0, true);
+            draw_moon(255);
+            set_scene_render_target(NULL);
+        }
+        SDL_Rect layer_rect = {0, 0, window_width, pond_height};
+        SDL_Rect src = background_layer_src();
+        SDL_RenderCopy(renderer, sky_layer.texture, &src, &layer_rect);
+    }
+    
+    // 如果有闪电，覆盖整个屏幕的半透明白色矩形
+    if (lightning_flash) {
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(renderer, flash_brightness, flash_brightness, flash_brightness, 100);
+        SDL_Rect flash_rect = {0, 0, window_width, window_height};
+        SDL_RenderFillRect(renderer, &flash_rect);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    }
+    
+    // 闪电照亮星星和月亮；没有缓存层时直接绘制，闪电亮度直接加到颜色上
+    if (sky_layer.texture) {
+        if (lightning_flash) {
+            flash_background_layer(&sky_layer, flash_brightness);
+        }
+    } else {
+        int flash_add = lightning_flash ? flash_brightness : 0;
+        draw_stars(star_visibility(), flash_add, false);
+        draw_moon((Uint8)fminf(255, moon_brightness() + flash_add));
+    }
     
     // 在暴风雨或中雨时绘制云层
     if (current_weather >= WEATHER_MEDIUM_RAIN) {
         int cloud_layers = 3;
         if (current_weather == WEATHER_HEAVY_RAIN) cloud_layers = 5;
         if (current_weather == WEATHER_THUNDERSTORM) cloud_layers = 7;
-        Uint32 current_time = SDL_GetTicks();
+        cloud_layers = (int)ceilf(cloud_layers * current_quality()->clouds);  // 画质调节器减少云层
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
         for (int layer = cloud_layers-1; layer >= 0; layer--) {
             // 计算云层位移（不同层以不同速度移动）
-            cloud_offsets[layer] = (int)((cloud_offsets[layer] + cloud_layers) * cloud_speed) % (WINDOW_WIDTH*2);
+            cloud_offsets[layer] = (int)((cloud_offsets[layer] + cloud_layers) * cloud_speed) % (window_width*2);
             
             // 设置纹理透明度
             SDL_SetTextureAlphaMod(cloud_textures[layer], 255);
             
             // 绘制双倍宽度纹理实现无缝滚动
-            SDL_Rect src_rect = { cloud_offsets[layer], 0, WINDOW_WIDTH, 200 };
-            SDL_Rect dest_rect = { 0, 0, WINDOW_WIDTH, 200 };
+            SDL_Rect src_rect = { cloud_offsets[layer], 0, window_width, 200 };
+            SDL_Rect dest_rect = { 0, 0, window_width, 200 };
             SDL_RenderCopy(renderer, cloud_textures[layer], &src_rect, &dest_rect);
             
             // 绘制剩余部分实现循环
-            if (cloud_offsets[layer] > WINDOW_WIDTH) {
-                SDL_Rect src_remain = { 0, 0, WINDOW_WIDTH*2 - cloud_offsets[layer], 200 };
-                SDL_Rect dest_remain = { cloud_offsets[layer] - WINDOW_WIDTH, 0, 
-                                        WINDOW_WIDTH*2 - cloud_offsets[layer], 200 };
+            if (cloud_offsets[layer] > window_width) {
+                SDL_Rect src_remain = { 0, 0, window_width*2 - cloud_offsets[layer], 200 };
+                SDL_Rect dest_remain = { cloud_offsets[layer] - window_width, 0, 
+                                        window_width*2 - cloud_offsets[layer], 200 };
                 SDL_RenderCopy(renderer, cloud_textures[layer], &src_remain, &dest_remain);
             }
         }
@@ -1568,111 +5771,48 @@ void render() {
     // 绘制闪电
     for (int i = 0; i < MAX_LIGHTNING; i++) {
         if (lightnings[i].active) {
-            SDL_SetRenderDrawColor(renderer, lightnings[i].brightness, lightnings[i].brightness, lightnings[i].brightness, 255);
-            
-            // 绘制主闪电路径
-            for (int j = 0; j < lightnings[i].segments; j++) {
-                // 绘制粗线条
-                for (int w = -lightnings[i].width; w <= lightnings[i].width; w++) {
-                    SDL_RenderDrawLine(renderer, 
-                                      lightnings[i].points[j][0] + w, 
-                                      lightnings[i].points[j][1],
-                                      lightnings[i].points[j+1][0] + w, 
-                                      lightnings[i].points[j+1][1]);
-                }
-            }
-            
-            // 绘制闪电光晕
-            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-            SDL_SetRenderDrawColor(renderer, lightnings[i].brightness, lightnings[i].brightness, lightnings[i].brightness, 50);
-            
-            for (int j = 0; j < lightnings[i].segments; j++) {
-                // 绘制更宽的半透明线条
-                for (int w = -lightnings[i].width*3; w <= lightnings[i].width*3; w++) {
-                    SDL_RenderDrawLine(renderer, 
-                                      lightnings[i].points[j][0] + w, 
-                                      lightnings[i].points[j][1],
-                                      lightnings[i].points[j+1][0] + w, 
-                                      lightnings[i].points[j+1][1]);
-                }
-            }
-            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+            render_lightning_bolt(&lightnings[i]);
         }
     }
     
-    // 绘制远山（3D背景）
-    for (int i = 0; i < MOUNTAIN_COUNT; i++) {
-        // 计算投影后的山位置
-        int mountain_proj_x = (int)project_x(mountains[i].x_offset, mountains[i].z);
-        
-        // 绘制山脉轮廓
-        SDL_Color base_color = mountains[i].color;
-        int peak_x = mountain_proj_x + WINDOW_WIDTH / 2;
-        int base_y = POND_HEIGHT;
-        int peak_y = base_y - mountains[i].height;
-        
-        // 预计算颜色变化范围
-        int color_variation = 5; // 减少颜色变化幅度
-        
-        // 填充山体（优化为按行绘制）
-        for (int y = peak_y; y <= base_y; y++) {
-            float height_ratio = (float)(y - peak_y) / (base_y - peak_y);
-            int current_width = (int)(mountains[i].width * height_ratio);
-            int start_x = peak_x - current_width / 2;
-            int end_x = peak_x + current_width / 2;
-            
-            if (current_width <= 0) continue;
-            
-            // 计算本行颜色
-            SDL_Color line_color = base_color;
-            line_color.r = (Uint8)fmin(255, fmax(0, line_color.r));
-            line_color.g = (Uint8)fmin(255, fmax(0, line_color.g));
-            line_color.b = (Uint8)fmin(255, fmax(0, line_color.b));
-            
-            // 闪电效果
-            if (lightning_flash) {
-                line_color.r = (Uint8)fmin(255, line_color.r + flash_brightness);
-                line_color.g = (Uint8)fmin(255, line_color.g + flash_brightness);
-                line_color.b = (Uint8)fmin(255, line_color.b + flash_brightness);
-            }
-            
-            SDL_SetRenderDrawColor(renderer, line_color.r, line_color.g, line_color.b, line_color.a);
-            
-            // 绘制整行（使用填充矩形代替逐点绘制）
-            SDL_Rect line_rect = {
-                start_x < 0 ? 0 : start_x,  // 限制在窗口范围内
-                y,
-                end_x - start_x + 1,
-                1
-            };
-            if (line_rect.x + line_rect.w > WINDOW_WIDTH) {
-                line_rect.w = WINDOW_WIDTH - line_rect.x;
-            }
-            if (line_rect.w > 0) {
-                SDL_RenderFillRect(renderer, &line_rect);
-            }
+    // 绘制远山（3D背景）：缓存层只随摄像机位置失效
+    if (mountain_layer.texture) {
+        if (background_layer_stale(&mountain_layer, 0)) {
+            begin_background_layer(mountain_layer.texture, 0, 0, 0, 0);
+            draw_mountains(false, 0);
+            begin_background_layer(mountain_layer.glow, 0, 0, 0, 0);
+            draw_mountains(true, 0);
+            set_scene_render_target(NULL);
         }
+        SDL_Rect layer_rect = {0, 0, window_width, pond_height};
+        SDL_Rect src = background_layer_src();
+        SDL_RenderCopy(renderer, mountain_layer.texture, &src, &layer_rect);
+        if (lightning_flash) {
+            flash_background_layer(&mountain_layer, flash_brightness);
+        }
+    } else {
+        draw_mountains(false, lightning_flash ? flash_brightness : 0);
     }
     
     // 绘制荷塘背景
     SDL_SetRenderDrawColor(renderer, 0, 30, 60, 255);  // 深蓝色荷塘
-    SDL_Rect pond_rect = {0, POND_HEIGHT, WINDOW_WIDTH, WINDOW_HEIGHT - POND_HEIGHT};
+    SDL_Rect pond_rect = {0, pond_height, window_width, window_height - pond_height};
     SDL_RenderFillRect(renderer, &pond_rect);
     
     // 绘制芦苇（受风影响摇摆）
-    float time_seconds = SDL_GetTicks() / 1000.0f;
+    float time_seconds = ft->render_ms / 1000.0f;
     
     for (int i = 0; i < REED_COUNT; i++) {
         // 计算投影位置
         int proj_x = (int)project_x(reeds[i].x, reeds[i].z);
         
         // 只绘制在屏幕内的芦苇
-        if (proj_x >= -10 && proj_x < WINDOW_WIDTH + 10) {
+        if (proj_x >= -10 && proj_x < window_width + 10) {
             // 风力影响芦苇摇摆幅度
             float wind_factor = wind_strength * 30.0f;
             
             // 摇摆角度计算 - 使用正弦函数
-            float sway_angle = sinf(time_seconds * reeds[i].sway_speed + reeds[i].sway_offset) * 
+            float sway_angle = table_sinf(time_seconds * reeds[i].sway_speed + reeds[i].sway_offset) * 
                                (0.1f + fabsf(wind_strength) * 0.5f); // 风越大摇摆越厉害
             
             // 芦苇颜色 - 随深度调整
@@ -1691,7 +5831,7 @@ void render() {
             
             // 绘制芦苇茎
             int stem_height = (int)(reeds[i].height * 0.7f);
-            int stem_end_x = proj_x + (int)(stem_height * sinf(sway_angle));
+            int stem_end_x = proj_x + (int)(stem_height * fast_sinf(sway_angle));
             int stem_end_y = (int)reeds[i].y - stem_height;
             
             SDL_RenderDrawLine(renderer, proj_x, (int)reeds[i].y, stem_end_x, stem_end_y);
@@ -1700,25 +5840,25 @@ void render() {
             int leaf_length = (int)(reeds[i].height * 0.5f);
             
             // 左叶
-            int leaf1_end_x = stem_end_x + (int)(leaf_length * sinf(sway_angle - 0.3f));
-            int leaf1_end_y = stem_end_y - (int)(leaf_length * cosf(sway_angle - 0.3f));
+            int leaf1_end_x = stem_end_x + (int)(leaf_length * fast_sinf(sway_angle - 0.3f));
+            int leaf1_end_y = stem_end_y - (int)(leaf_length * fast_cosf(sway_angle - 0.3f));
             SDL_RenderDrawLine(renderer, stem_end_x, stem_end_y, leaf1_end_x, leaf1_end_y);
             
             // 右叶
-            int leaf2_end_x = stem_end_x + (int)(leaf_length * sinf(sway_angle + 0.3f));
-            int leaf2_end_y = stem_end_y - (int)(leaf_length * cosf(sway_angle + 0.3f));
+            int leaf2_end_x = stem_end_x + (int)(leaf_length * fast_sinf(sway_angle + 0.3f));
+            int leaf2_end_y = stem_end_y - (int)(leaf_length * fast_cosf(sway_angle + 0.3f));
             SDL_RenderDrawLine(renderer, stem_end_x, stem_end_y, leaf2_end_x, leaf2_end_y);
         }
     }
     
     // 绘制荷叶
-    for (int i = 0; i < LOTUS_PAD_COUNT; i++) {
+    for (int i = 0; i < lotus_pad_count; i++) {
         // 计算投影坐标
         int proj_x = (int)project_x(lotus_pads[i].x, lotus_pads[i].z);
         
         // 只绘制在屏幕内的荷叶
         if (proj_x + (int)lotus_pads[i].radius >= 0 && 
-            proj_x - (int)lotus_pads[i].radius < WINDOW_WIDTH) {
+            proj_x - (int)lotus_pads[i].radius < window_width) {
             
             // 应用倾斜效果 - 创建椭圆
             float tilt = lotus_pads[i].tilt_angle + wind_strength * 0.2f;
@@ -1736,226 +5876,146 @@ void render() {
         
         // 只绘制在屏幕内的荷花
         if (proj_x + (int)lotus_flowers[i].size >= 0 && 
-            proj_x - (int)lotus_flowers[i].size < WINDOW_WIDTH) {
+            proj_x - (int)lotus_flowers[i].size < window_width) {
             
             // 风的影响
-            float wind_sway = sinf(time_seconds + lotus_flowers[i].sway_phase) * wind_strength * 5.0f;
+            float wind_sway = table_sinf(time_seconds + lotus_flowers[i].sway_phase) * wind_strength * 5.0f;
             
             // 荷花茎
             SDL_SetRenderDrawColor(renderer, 0, 100, 50, 255);
             SDL_RenderDrawLine(renderer,
                              proj_x + (int)wind_sway, lotus_flowers[i].y + (int)lotus_flowers[i].size,
-                             proj_x, POND_HEIGHT);
+                             proj_x, pond_height);
             
-            // 荷花颜色可能被闪电影响
-            SDL_Color flower_color = lotus_flowers[i].color;
-            if (lightning_flash) {
-                flower_color.r = (Uint8)fminf(255, flower_color.r + flash_brightness);
-                flower_color.g = (Uint8)fminf(255, flower_color.g + flash_brightness);
-                flower_color.b = (Uint8)fminf(255, flower_color.b + flash_brightness);
-            }
+            if (!lotus_flowers[i].texture) continue;
             
-            // 绘制荷花花瓣
-            for (int p = 0; p < lotus_flowers[i].petal_count; p++) {
-                float angle = p * 6.28f / lotus_flowers[i].petal_count + time_seconds * 0.1f;
-                
-                // 内层花瓣
-                SDL_SetRenderDrawColor(renderer, flower_color.r, flower_color.g, flower_color.b, 255);
-                for (int r = 0; r < lotus_flowers[i].size; r++) {
-                    float petal_width = sinf(r / lotus_flowers[i].size * 3.14f) * lotus_flowers[i].size * 0.5f;
-                    for (int w = -(int)petal_width; w <= (int)petal_width; w++) {
-                        int petal_x = proj_x + (int)(r * cosf(angle)) + w + (int)wind_sway;
-                        int petal_y = lotus_flowers[i].y + (int)(r * sinf(angle));
-                        
-                        if (petal_x >= 0 && petal_x < WINDOW_WIDTH && 
-                            petal_y >= 0 && petal_y < WINDOW_HEIGHT) {
-                            SDL_RenderDrawPoint(renderer, petal_x, petal_y);
-                        }
-                    }
-                }
-            }
+            // 按旋转角度选取预渲染的动画帧
+            float period = 6.28f / lotus_flowers[i].petal_count;
+            float rotation = fmodf(time_seconds * 0.1f, period);
+            int frame = (int)(rotation / period * LOTUS_FLOWER_FRAMES) % LOTUS_FLOWER_FRAMES;
+            int frame_w = lotus_flowers[i].frame_half_w * 2 + 1;
+            int frame_h = lotus_flowers[i].frame_half_h * 2 + 1;
+            SDL_Rect src = {
+                (frame % LOTUS_FLOWER_FRAME_COLUMNS) * frame_w,
+                (frame / LOTUS_FLOWER_FRAME_COLUMNS) * frame_h,
+                frame_w, frame_h
+            };
+            SDL_Rect dest = {
+                proj_x + (int)wind_sway - lotus_flowers[i].frame_half_w,
+                (int)lotus_flowers[i].y - lotus_flowers[i].frame_half_h,
+                frame_w, frame_h
+            };
+            SDL_RenderCopy(renderer, lotus_flowers[i].texture, &src, &dest);
             
-            // 荷花中心
-            SDL_SetRenderDrawColor(renderer, 255, 220, 0, 255);
-            int center_size = (int)(lotus_flowers[i].size * 0.3f);
-            for (int y = -center_size; y <= center_size; y++) {
-                for (int x = -center_size; x <= center_size; x++) {
-                    if (x*x + y*y <= center_size*center_size) {
-                        int cx = proj_x + x + (int)wind_sway;
-                        int cy = lotus_flowers[i].y + y;
-                        
-                        if (cx >= 0 && cx < WINDOW_WIDTH && cy >= 0 && cy < WINDOW_HEIGHT) {
-                            SDL_RenderDrawPoint(renderer, cx, cy);
-                        }
-                    }
-                }
+            // 闪电照亮荷花：以加色混合再叠加一次，颜色调制取闪电亮度
+            if (lightning_flash) {
+                SDL_SetTextureBlendMode(lotus_flowers[i].texture, SDL_BLENDMODE_ADD);
+                SDL_SetTextureColorMod(lotus_flowers[i].texture, flash_brightness, flash_brightness, flash_brightness);
+                SDL_RenderCopy(renderer, lotus_flowers[i].texture, &src, &dest);
+                SDL_SetTextureColorMod(lotus_flowers[i].texture, 255, 255, 255);
+                SDL_SetTextureBlendMode(lotus_flowers[i].texture, SDL_BLENDMODE_BLEND);
             }
         }
     }
     
-    // 绘制涟漪
-    for (int i = 0; i < MAX_RIPPLES; i++) {
-        if (ripples[i].active) {
-            // 计算投影坐标
-            int proj_x = (int)project_x(ripples[i].x, ripples[i].z);
-            
-            // 如果涟漪在屏幕上
-            if (proj_x + (int)ripples[i].radius >= 0 && 
-                proj_x - (int)ripples[i].radius < WINDOW_WIDTH) {
-                
-                // 根据深度调整颜色
-                SDL_Color adjusted_color = adjust_color_by_depth(ripples[i].color, ripples[i].z);
-                
-                // 闪电可能会影响涟漪颜色
-                if (lightning_flash) {
-                    adjusted_color.r = (Uint8)fminf(255, adjusted_color.r + flash_brightness / 2);
-                    adjusted_color.g = (Uint8)fminf(255, adjusted_color.g + flash_brightness / 2);
-                    adjusted_color.b = (Uint8)fminf(255, adjusted_color.b + flash_brightness / 2);
-                }
-                
+    // 涟漪、水珠和雨滴数量最多：软件渲染时记录成命令，由工作线程按屏幕分块并行绘制
+    int flash_add = lightning_flash ? flash_brightness / 2 : 0;
+    if (soft_raster.active) {
+        raster_begin();
+    }
+    
+    // 绘制涟漪：每个涟漪从图集中取一个预渲染的圆环，一次拷贝完成
+    // 圆环只在水面以下可见，用裁剪矩形代替逐点判断
+    SDL_Rect pond_clip = {0, pond_height, window_width, window_height - pond_height};
+    if (soft_raster.active) {
+        // 精灵命令直接使用帧像素坐标
+        int pond_y = raster_scaled(pond_height);
+        SDL_Rect raster_pond_clip = {0, pond_y, render_width, render_height - pond_y};
+        for (int i = 0; soft_raster.ripple_atlas != NULL && i < ripple_count; i++) {
+            SDL_Color color;
+            const SDL_Rect* src;
+            SDL_Rect dest;
+            int slot;
+            if (ripple_sprite(i, ft, flash_add, soft_raster.scale, &color, &src, &dest) &&
+                (slot = raster_reserve(1)) >= 0) {
+                raster_sprite(&soft_raster.cmds[slot], src, &dest, color, &raster_pond_clip);
+            }
+        }
+    } else if (ripple_atlas != NULL) {
+        SDL_RenderSetClipRect(renderer, &pond_clip);
+        for (int i = 0; i < ripple_count; i++) {
+            SDL_Color color;
+            const SDL_Rect* src;
+            SDL_Rect dest;
+            if (ripple_sprite(i, ft, flash_add, 1.0f, &color, &src, &dest)) {
                 // 设置颜色并考虑透明度
-                SDL_SetRenderDrawColor(renderer, 
-                                      adjusted_color.r,
-                                      adjusted_color.g,
-                                      adjusted_color.b,
-                                      adjusted_color.a);
-                
-                // 根据深度计算实际半径
-                float z_scale = get_z_scale(ripples[i].z);
-                int radius = (int)(ripples[i].radius * z_scale);
-                
-                // 椭圆压缩系数 - 根据y位置不同而变化，实现透视效果
-                float y_perspective = (ripples[i].y - POND_HEIGHT) / (WINDOW_HEIGHT - POND_HEIGHT);
-                float ellipse_factor = 0.3f + y_perspective * 0.2f;
-                
-                // 绘制多个细线条的椭圆
-                for (int r = radius - 2; r <= radius; r++) {
-                    // 计算圆周上的点并绘制
-                    for (int angle = 0; angle < 360; angle += 5) {
-                        float rad = angle * 3.14159f / 180.0f;
-                        int x = (int)(proj_x + r * cosf(rad));
-                        int y = (int)(ripples[i].y + r * ellipse_factor * sinf(rad));
-                        
-                        if (x >= 0 && x < WINDOW_WIDTH && y >= POND_HEIGHT && y < WINDOW_HEIGHT) {
-                            SDL_RenderDrawPoint(renderer, x, y);
-                        }
-                    }
-                }
+                SDL_SetTextureColorMod(ripple_atlas, color.r, color.g, color.b);
+                SDL_SetTextureAlphaMod(ripple_atlas, color.a);
+                SDL_RenderCopy(renderer, ripple_atlas, src, &dest);
             }
         }
+        SDL_RenderSetClipRect(renderer, NULL);
     }
     
-    // 绘制溅射水珠
-    for (int i = 0; i < MAX_SPLASHES; i++) {
-        if (splashes[i].active) {
-            // 计算投影坐标
-            int proj_x = (int)project_x(splashes[i].x, splashes[i].z);
-            
-            // 根据深度调整大小
-            float z_scale = get_z_scale(splashes[i].z);
-            int size = (int)(splashes[i].size * z_scale);
-            
-            // 只绘制在屏幕内的水珠
-            if (proj_x >= 0 && proj_x < WINDOW_WIDTH && 
-                splashes[i].y >= 0 && splashes[i].y < WINDOW_HEIGHT) {
-                
-                // 根据深度调整颜色
-                SDL_Color adjusted_color = adjust_color_by_depth(splashes[i].color, splashes[i].z);
-                
-                // 闪电会影响水珠颜色
-                if (lightning_flash) {
-                    adjusted_color.r = (Uint8)fminf(255, adjusted_color.r + flash_brightness / 2);
-                    adjusted_color.g = (Uint8)fminf(255, adjusted_color.g + flash_brightness / 2);
-                    adjusted_color.b = (Uint8)fminf(255, adjusted_color.b + flash_brightness / 2);
-                }
-                
-                // 设置颜色
-                SDL_SetRenderDrawColor(renderer, 
-                                      adjusted_color.r,
-                                      adjusted_color.g,
-                                      adjusted_color.b,
-                                      adjusted_color.a);
-                
-                // 绘制水珠 - 小圆点
-                for (int y = -size; y <= size; y++) {
-                    for (int x = -size; x <= size; x++) {
-                        if (x*x + y*y <= size*size) {
-                            int px = proj_x + x;
-                            int py = (int)splashes[i].y + y;
-                            
-                            if (px >= 0 && px < WINDOW_WIDTH && py >= 0 && py < WINDOW_HEIGHT) {
-                                SDL_RenderDrawPoint(renderer, px, py);
-                            }
-                        }
+    // 绘制溅射水珠 - 小圆点
+    for (int i = 0; i < splash_count; i++) {
+        SDL_Color color;
+        int cx, cy, size;
+        if (!splash_disc(i, ft, flash_add, &color, &cx, &cy, &size)) continue;
+        
+        if (soft_raster.active) {
+            int slot = raster_reserve(1);
+            if (slot >= 0) raster_disc(&soft_raster.cmds[slot], cx, cy, size, color);
+            continue;
+        }
+        
+        // 设置颜色
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        for (int y = -size; y <= size; y++) {
+            for (int x = -size; x <= size; x++) {
+                if (x*x + y*y <= size*size) {
+                    int px = cx + x;
+                    int py = cy + y;
+                    
+                    if (px >= 0 && px < window_width && py >= 0 && py < window_height) {
+                        SDL_RenderDrawPoint(renderer, px, py);
                     }
                 }
             }
         }
     }
     
-    // 绘制雨滴
-    for (int i = 0; i < MAX_RAINDROPS; i++) {
-        if (raindrops[i].active && !raindrops[i].in_water) {
-            // 计算投影坐标
-            int proj_x = (int)project_x(raindrops[i].x, raindrops[i].z);
-            
-            // 根据深度调整大小
-            float z_scale = get_z_scale(raindrops[i].z);
-            int actual_size = (int)(raindrops[i].size * z_scale);
-            
-            // 只绘制在屏幕内的雨滴
-            if (proj_x >= 0 && proj_x < WINDOW_WIDTH && 
-                raindrops[i].y >= 0 && raindrops[i].y < WINDOW_HEIGHT) {
-                
-                // 根据深度调整颜色
-                SDL_Color adjusted_color = adjust_color_by_depth(raindrops[i].color, raindrops[i].z);
-                
-                // 闪电会增亮雨滴
-                if (lightning_flash) {
-                    adjusted_color.r = (Uint8)fminf(255, adjusted_color.r + flash_brightness / 2);
-                    adjusted_color.g = (Uint8)fminf(255, adjusted_color.g + flash_brightness / 2);
-                    adjusted_color.b = (Uint8)fminf(255, adjusted_color.b + flash_brightness / 2);
-                }
-                
-                // 设置颜色
-                SDL_SetRenderDrawColor(renderer, 
-                                      adjusted_color.r,
-                                      adjusted_color.g,
-                                      adjusted_color.b,
-                                      adjusted_color.a);
-                
-                // 计算雨滴的倾斜角度 - 受风影响
-                float rain_angle = wind_strength * 0.7f; // -0.7 到 0.7 弧度
-                
-                // 雨滴长度受强度影响
-                int drop_length = actual_size * (1 + weather_intensity / 100);
-                
-                // 计算雨滴起点和终点 - 考虑风力倾斜
-                int end_x = proj_x;
-                int end_y = (int)raindrops[i].y;
-                int start_x = end_x - (int)(drop_length * sinf(rain_angle));
-                int start_y = end_y - (int)(drop_length * cosf(rain_angle));
-                
-                // 雨滴间歇性出现，以获得更真实的效果
-                Uint32 current_time = SDL_GetTicks();
-                int visibility = (current_time / 50) % 5;  // 0-4循环
-                
-                if (visibility < 3) {  // 在5个时间单位中可见3个
-                    // 绘制雨滴（短线）- 考虑风力倾斜
-                    SDL_RenderDrawLine(renderer, start_x, start_y, end_x, end_y);
-                }
+    // 雨滴间歇性出现，以获得更真实的效果（整帧共用同一时刻）
+    bool raindrops_visible = (ft->render_ms / 50) % 5 < 3;  // 在5个时间单位中可见3个
+    
+    // 绘制雨滴（短线）- 考虑风力倾斜
+    if (raindrops_visible && soft_raster.active) {
+        RaindropRasterJob job = {ft, flash_add, raster_reserve(raindrop_count)};
+        if (job.first >= 0) {
+            parallel_for(raindrop_count, PARALLEL_CHUNK_SIZE, record_raindrops_range, &job);
+        }
+    } else if (raindrops_visible) {
+        for (int i = 0; i < raindrop_count; i++) {
+            SDL_Color color;
+            int start_x, start_y, end_x, end_y;
+            if (raindrop_line(i, ft, flash_add, &color, &start_x, &start_y, &end_x, &end_y)) {
+                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+                SDL_RenderDrawLine(renderer, start_x, start_y, end_x, end_y);
             }
         }
     }
     
+    if (soft_raster.active) {
+        raster_end();
+    }
+    
     // 模拟雷声视觉效果 - 屏幕部分闪烁
     if (thunder_active) {
-        Uint32 current_time = SDL_GetTicks();
-        Uint32 thunder_age = current_time - thunder_start_time;
+        Uint32 thunder_age = ft->render_ms - thunder_start_time;
         
         if (thunder_age < thunder_duration) {
             // 余弦波模拟雷声强度变化
-            float thunder_intensity = cosf(thunder_age * 3.14159f * 5 / thunder_duration) * 0.5f + 0.5f;
+            float thunder_intensity = fast_cosf(thunder_age * 3.14159f * 5 / thunder_duration) * 0.5f + 0.5f;
             thunder_intensity *= (1.0f - (float)thunder_age / thunder_duration); // 随时间衰减
             
             if (thunder_intensity > 0.05f) {
@@ -1966,9 +6026,9 @@ void render() {
                 // 在底部随机绘制一些线条模拟震动
                 int lines = (int)(20 * thunder_intensity);
                 for (int j = 0; j < lines; j++) {
-                    int y = WINDOW_HEIGHT - rand() % 100;
-                    int length = 20 + rand() % 100;
-                    int x = rand() % (WINDOW_WIDTH - length);
+                    int y = window_height - rng_int(&render_rng, 100);
+                    int length = 20 + rng_int(&render_rng, 100);
+                    int x = rng_int(&render_rng, window_width - length);
                     
                     SDL_RenderDrawLine(renderer, x, y, x + length, y);
                 }
@@ -1979,11 +6039,11 @@ void render() {
     }
     
     // 绘制天气状态信息
-    render_weather_info();
+    render_weather_info(ft);
 }
 
 // 绘制天气信息
-void render_weather_info() {
+void render_weather_info(const FrameTime* ft) {
     // 在屏幕左上角显示当前天气信息和控制提示
     char* weather_name;
     SDL_Color weather_color;
@@ -2072,8 +6132,7 @@ void render_weather_info() {
     
     // 检查是否有雷声，如果有则显示闪烁的"雷声"指示器
     if (thunder_active) {
-        Uint32 current_time = SDL_GetTicks();
-        if ((current_time / 100) % 2 == 0) { // 闪烁效果
+        if ((ft->render_ms / 100) % 2 == 0) { // 闪烁效果
             SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
             SDL_Rect thunder_indicator = {170, 20, 15, 15};
             SDL_RenderFillRect(renderer, &thunder_indicator);